@@ -3,19 +3,25 @@
  * https://github.com/moononournation/ATtinyWatch
  */
 #include <avr/sleep.h>
-#include <TinyWireM.h>
 #include <EEPROM.h>
 #include "ssd1306.h"
 #include "WDT_Time.h"
+#include "Button.h"
+#include "Energy.h"
+#include "Analog_Face.h"
+#include "Alarm.h"
 
 #define TIMEOUT 3000 // 3 seconds
+// panel power profiles for the battery with SSD1306_POWER_PROFILES (ssd1306.h)
+#define DIM_VCC 2400 // mV, dimmed panel below
+//#define GLANCE_PROFILE // only the time rows below GLANCE_VCC, not verified on a panel yet
+#define GLANCE_VCC 2100 // mV
+#define PROFILE_HYSTERESIS 100 // mV, to leave a low battery profile
+#if defined(WATCH_POWER_PAGE) && !defined(SSD1306_STATS)
+#error "the power page shows the bus counts of SSD1306_STATS (ssd1306.h)"
+#endif
 #define UNUSEDPINA 1
 #define UNUSEDPINB 4
-#define BUTTONPIN  3
-
-#define SET_UP_BUTTON_THRESHOLD 100
-#define UP_DOWN_BUTTON_THRESHOLD 600
-#define PRESSED_BUTTON_THRESHOLD 1000
 
 // enum
 typedef enum {
@@ -23,7 +29,15 @@ typedef enum {
 }  run_status_t;
 
 typedef enum {
-  time_mode, debug_mode
+  time_mode,
+#ifdef WATCH_ANALOG_FACE
+  analog_mode,
+#endif
+  debug_mode,
+#ifdef WATCH_POWER_PAGE
+  power_mode,
+#endif
+  display_mode_count
 }  display_mode_t;
 
 // button field constant
@@ -35,6 +49,9 @@ typedef enum {
 #define MINUTE_FIELD 5
 #define SECOND_FIELD 6
 #define FIELD_COUNT 6
+// time page values kept by field number, the info values around them
+#define TEMP_SLOT NO_FIELD
+#define BATTERY_SLOT (FIELD_COUNT + 1)
 
 // variables
 SSD1306 oled;
@@ -44,6 +61,21 @@ static display_mode_t display_mode = time_mode;
 static display_mode_t last_display_mode = time_mode;
 static bool time_changed = false;
 static uint8_t selected_field = NO_FIELD;
+static bool redraw = true; // display content out of date
+static time_t drawn_time = 0; // the second on screen
+// the time page as drawn, a field is only sent again when its value changes
+static uint8_t drawn_value[FIELD_COUNT + 2];
+#ifdef SSD1306_STATS
+// columns and pages of each value, what the driver is spared when it is kept
+static const uint8_t field_area[FIELD_COUNT + 2][2] PROGMEM = {
+  {(2 * FONT_WIDTH) + 3 + FONT_WIDTH, 1}, // TEMP_SLOT, 2 digits, degree sign and C
+  {4 * FONT_WIDTH, 1}, {2 * FONT_WIDTH, 1}, {2 * FONT_WIDTH, 1}, // YEAR_FIELD, MONTH_FIELD, DAY_FIELD
+  {2 * FONT_2X_WIDTH, 2}, {2 * FONT_2X_WIDTH, 2}, {2 * FONT_2X_WIDTH, 2}, // HOUR_FIELD, MINUTE_FIELD, SECOND_FIELD
+  {13, 1} // BATTERY_SLOT
+};
+#endif
+static uint8_t drawn_selected = NO_FIELD;
+static bool time_page_drawn = false; // cleared with the panel
 
 void setup() {
   // setup input pins, also pullup unused pin for power saving purpose
@@ -51,11 +83,16 @@ void setup() {
   pinMode(UNUSEDPINB, INPUT_PULLUP);
   pinMode(BUTTONPIN, INPUT_PULLUP);
 
-  // init time
+  // init time and the alarms set before
   init_time();
+#ifdef WATCH_ALARMS
+  alarm_begin();
+#endif
+
+  // first Vcc and temperature reading
+  init_adc();
 
   // init I2C and OLED
-  TinyWireM.begin();
   oled.begin();
   oled.fill(0x00); // clear in black
 
@@ -64,8 +101,16 @@ void setup() {
 }
 
 void loop() {
-  // detect and handle button input
-  check_button();
+  // detect and handle button input, unless a sampling round is using the ADC
+  if (!adc_busy() && check_button()) redraw = true;
+
+#ifdef WATCH_ALARMS
+  // an alarm or timer going off wakes the display as the button does
+  if (alarm_service()) {
+    ENERGY_COUNT(alarms);
+    wake_up();
+  }
+#endif
 
   if (run_status == sleeping) {
     // return to sleep mode after WDT interrupt
@@ -74,29 +119,46 @@ void loop() {
     if (millis() > display_timeout) { // check display timeout
       enter_sleep();
     } else { // normal flow
-      readRawVcc();
-      readRawTemp();
-      draw_oled();
+      // render only for an event: button, new sensor values or next second
+      if (adc_service()) redraw = true;
+      if (now() != drawn_time) redraw = true;
+
+      if (redraw) {
+        drawn_time = now();
+        draw_oled();
+        redraw = false;
+      } else {
+        // wait next interrupt: WDT tick, button, ADC or millis() timer
+        system_idle();
+      }
     } // normal flow
   } // not sleeping
 }
 
 void enter_sleep() {
   oled.fill(0x00); // clear screen to avoid show old time when wake up
+  time_page_drawn = false;
+#ifdef WATCH_ANALOG_FACE
+  analog_face_reset();
+#endif
   oled.off();
+  while (oled.busy()) system_idle(); // power down would stop the transfer
   delay(2); // wait oled stable
 
+  set_wdt_interval(WDT_SLEEP_INTERVAL); // fewer wake ups while nothing to show
   run_status = sleeping;
 }
 
 void wake_up() {
   run_status = normal;
+  set_wdt_interval(WDT_INTERVAL); // 1 second ticks again for the display
 
   delay(2); // wait oled stable
   oled.on();
 
   // update display timeout
   set_display_timeout();
+  redraw = true;
 }
 
 void set_display_timeout() {
@@ -108,51 +170,126 @@ void set_display_timeout() {
  */
 
 void draw_oled() {
+#ifdef SSD1306_POWER_PROFILES
+  uint8_t profile = choose_power_profile(getVcc());
+  if (profile != oled.get_power_profile()) oled.set_power_profile(profile);
+#endif
+
   if (display_mode != last_display_mode) {
     oled.fill(0x00);
+    time_page_drawn = false;
+#ifdef WATCH_ANALOG_FACE
+    analog_face_reset();
+#endif
     last_display_mode = display_mode;
   }
   oled.set_font_size(1);
   if (display_mode == time_mode) {
+    // take all fields from one now(), separate calls may straddle a second boundary
+    tmElements_t tm;
+    nowElements(tm);
+    if (selected_field != drawn_selected) time_page_drawn = false; // the inverted field moved
+    drawn_selected = selected_field;
+
     // 1st row: print info
-    oled.set_pos(0, 0);
-    oled.print(getTemp() / 1000);
-    oled.draw_pattern(1, 0b00000010);
-    oled.draw_pattern(1, 0b00000101);
-    oled.draw_pattern(1, 0b00000010);
-    oled.write('C');
+    if (field_changed(TEMP_SLOT, getTempC())) {
+      oled.set_pos(0, 0);
+      oled.print(getTempC());
+      oled.draw_pattern(1, 0b00000010);
+      oled.draw_pattern(1, 0b00000101);
+      oled.draw_pattern(1, 0b00000010);
+      oled.write('C');
+    }
 
     // top right corner: battery status
-    uint32_t vcc = getVcc();
-    // show battery bar from 1.8 V to 3.0 V in 8 pixels, (3000 - 1800) / 8 = 150
-    uint8_t bat_level = (vcc >= 3000) ? 8 : ((vcc <= 1800) ? 1 : ((vcc - 1800 + 150) / 150));
-    oled.draw_pattern(51, 0, 1, 1, 0b00111111);
-    oled.draw_pattern(1, 0b00100001);
-    oled.draw_pattern(bat_level, 0b00101101);
-    oled.draw_pattern(8 + 1 - bat_level, 0b00100001);
-    oled.draw_pattern(1, 0b00111111);
-    oled.draw_pattern(1, 0b00001100);
+    uint8_t bat_level = battery_level(getVcc());
+    if (field_changed(BATTERY_SLOT, bat_level)) {
+      oled.draw_pattern(51, 0, 1, 1, 0b00111111);
+      oled.draw_pattern(1, 0b00100001);
+      oled.draw_pattern(bat_level, 0b00101101);
+      oled.draw_pattern(8 + 1 - bat_level, 0b00100001);
+      oled.draw_pattern(1, 0b00111111);
+      oled.draw_pattern(1, 0b00001100);
+    }
 
     // 2nd row: print date
-    print_digit(7, 1, year(), (selected_field == YEAR_FIELD));
-    oled.write('-');
-    print_digit(7 + (5 * FONT_WIDTH), 1, month(), (selected_field == MONTH_FIELD));
-    oled.write('-');
-    print_digit(7 + (8 * FONT_WIDTH), 1, day(), (selected_field == DAY_FIELD));
+    if (!time_page_drawn) {
+      oled.set_pos(7 + (4 * FONT_WIDTH), 1);
+      oled.write('-');
+      oled.set_pos(7 + (7 * FONT_WIDTH), 1);
+      oled.write('-');
+    }
+    if (field_changed(YEAR_FIELD, tm.Year)) print_digit(7, 1, tmYearToCalendar(tm.Year), (selected_field == YEAR_FIELD));
+    if (field_changed(MONTH_FIELD, tm.Month)) print_digit(7 + (5 * FONT_WIDTH), 1, tm.Month, (selected_field == MONTH_FIELD));
+    if (field_changed(DAY_FIELD, tm.Day)) print_digit(7 + (8 * FONT_WIDTH), 1, tm.Day, (selected_field == DAY_FIELD));
 
     // 3rd-4th rows: print time
     oled.set_font_size(2);
-    print_digit(0, 2, hour(), (selected_field == HOUR_FIELD));
-    oled.draw_pattern(2 * FONT_2X_WIDTH + 1, 2, 2, 2, 0b00011000);
-    print_digit(2 * FONT_2X_WIDTH + 5, 2, minute(), (selected_field == MINUTE_FIELD));
-    oled.draw_pattern(4 * FONT_2X_WIDTH + 6, 2, 2, 2, 0b00011000);
-    print_digit(4 * FONT_2X_WIDTH + 2 * FONT_WIDTH, 2, second(), (selected_field == SECOND_FIELD));
+    if (!time_page_drawn) {
+      oled.draw_pattern(2 * FONT_2X_WIDTH + 1, 2, 2, 2, 0b00011000);
+      oled.draw_pattern(4 * FONT_2X_WIDTH + 6, 2, 2, 2, 0b00011000);
+    }
+    if (field_changed(HOUR_FIELD, tm.Hour)) print_digit(0, 2, tm.Hour, (selected_field == HOUR_FIELD));
+    if (field_changed(MINUTE_FIELD, tm.Minute)) print_digit(2 * FONT_2X_WIDTH + 5, 2, tm.Minute, (selected_field == MINUTE_FIELD));
+    if (field_changed(SECOND_FIELD, tm.Second)) print_digit(4 * FONT_2X_WIDTH + 2 * FONT_WIDTH, 2, tm.Second, (selected_field == SECOND_FIELD));
+    time_page_drawn = true;
+#ifdef WATCH_ANALOG_FACE
+  } else if (display_mode == analog_mode) { // analog_mode
+    tmElements_t tm;
+    nowElements(tm);
+    analog_face_draw(oled, tm);
+#endif
   } else if (display_mode == debug_mode) { // debug_mode
     print_debug_value(0, 'I', get_wdt_interrupt_count());
     print_debug_value(1, 'M', get_wdt_microsecond_per_interrupt());
     print_debug_value(2, 'V', getVcc());
     print_debug_value(3, 'T', getRawTemp());
-  } // debug_mode
+#ifdef WATCH_POWER_PAGE
+  } else if (display_mode == power_mode) { // power_mode
+    print_power_value(0, 0, 'A', energy_average_ua(get_uptime(), oled.get_sent_bytes(), oled.get_sent_transactions())); // uA
+    print_power_value(32, 0, 'E', energy_counters.eeprom_writes);
+    print_power_value(0, 1, 'S', energy_awake_ms() / 1000);
+    print_power_value(32, 1, 'F', energy_counters.frames);
+    print_power_value(0, 2, 'B', oled.get_sent_bytes());
+    print_power_value(32, 2, 'D', energy_counters.adc_conversions);
+    print_power_value(0, 3, 'W', energy_counters.wdt_wakes);
+    print_power_value(32, 3, 'P', energy_counters.button_wakes);
+#endif
+  } // power_mode
+  oled.flush();
+  ENERGY_COUNT(frames);
+}
+
+#ifdef SSD1306_POWER_PROFILES
+// panel power profile for the battery, the glance shows only the large time, not while adjusting it
+uint8_t choose_power_profile(uint32_t vcc) {
+  uint8_t current = oled.get_power_profile();
+  if (current != SSD1306_PROFILE_NORMAL) vcc -= PROFILE_HYSTERESIS; // stay until the supply recovers
+#ifdef GLANCE_PROFILE
+  if ((vcc < GLANCE_VCC) && (display_mode == time_mode) && (selected_field == NO_FIELD)) return SSD1306_PROFILE_GLANCE;
+#endif
+  if (vcc < DIM_VCC) return SSD1306_PROFILE_DIM;
+  return SSD1306_PROFILE_NORMAL;
+}
+#endif
+
+// battery bar from 1.8 V to 3.0 V in 8 pixels, (3000 - 1800) / 8 = 150 mV each
+uint8_t battery_level(uint32_t vcc) {
+  if (vcc >= 3000) return 8;
+  if (vcc <= 1800) return 1;
+  return ((vcc - 1800 + 150) * 437UL) >> 16; // 437 / 65536 = 1 / 150 a little over, exact up to 1350
+}
+
+// true if a field of the time page is to show another value, it is then taken as drawn
+bool field_changed(uint8_t field, uint8_t value) {
+  if (time_page_drawn && (drawn_value[field] == value)) {
+#ifdef SSD1306_STATS
+    oled.skip_area(pgm_read_byte(&field_area[field][0]), pgm_read_byte(&field_area[field][1]));
+#endif
+    return false;
+  }
+  drawn_value[field] = value;
+  return true;
 }
 
 void print_digit(uint8_t col, uint8_t page, int value, bool invert_color) {
@@ -170,30 +307,66 @@ void print_debug_value(uint8_t page, char initial, uint32_t value) {
   oled.print(value);
 }
 
+#ifdef WATCH_POWER_PAGE
+// initial and up to 4 characters, large values in K or M
+void print_power_value(uint8_t col, uint8_t page, char initial, uint32_t value) {
+  char unit = 0;
+  if (value >= 10000000) {
+    value /= 1000000;
+    unit = 'M';
+  } else if (value >= 10000) {
+    value /= 1000;
+    unit = 'K';
+  }
+  uint8_t chars = (unit) ? 2 : 1;
+  for (uint32_t v = value; v >= 10; v /= 10) chars++;
+
+  oled.set_pos(col, page);
+  oled.write(initial);
+  oled.print(value);
+  if (unit) oled.write(unit);
+  if (chars < 4) oled.draw_pattern((4 - chars) * FONT_WIDTH, 0x00); // clear what a longer value left
+}
+#endif
+
 // PIN CHANGE interrupt event function
+// it also wakes the chip inside a long sleep tick, loop() then reads the button
 ISR(PCINT0_vect) {
   set_display_timeout(); // extent display timeout while user input
+  button_changed(); // sample the ladder at once
 }
 
-void check_button() {
-  int buttonValue = analogRead(BUTTONPIN);
+// handle button events, return true if the display need redraw
+bool check_button() {
+  if (run_status == sleeping) {
+    // wake_up if button pressed while sleeping, that press does nothing else
+    if (!button_wake()) return false;
+    set_display_timeout();
+    wake_up();
+    return true;
+  }
 
-  if (buttonValue < PRESSED_BUTTON_THRESHOLD) { // button down
-    set_display_timeout(); // extent display timeout while user input
+  button_t button;
+  button_event_t event = button_poll(button);
+  if (event == button_no_event) return false;
+  set_display_timeout(); // extent display timeout while user input
 
-    if (run_status == sleeping) {
-      // wake_up if button pressed while sleeping
-      wake_up();
-    } else { // not sleeping
-      if (buttonValue > UP_DOWN_BUTTON_THRESHOLD) { // down button
-        handle_adjust_button_pressed(-1);
-      } else if (buttonValue > SET_UP_BUTTON_THRESHOLD) { // up button
-        handle_adjust_button_pressed(1);
-      } else { // set button
-        handle_set_button_pressed();
-      }
-    } // not sleeping
-  } // button down
+  if (button == button_set) {
+    if (event == button_press) {
+      handle_set_button_pressed();
+#ifdef WATCH_BUTTON_REPEAT
+    } else if (event == button_long_press) { // hold set to finish time adjustment at any field
+      finish_time_adjust();
+#endif
+    }
+  } else { // up and down buttons, repeat while held
+#ifdef WATCH_BUTTON_REPEAT
+    if (event == button_long_press) return false;
+    if ((event == button_repeat) && (selected_field == NO_FIELD)) return false; // no display mode flicker
+#endif
+    handle_adjust_button_pressed((button == button_up) ? 1 : -1);
+  }
+  return true;
 }
 
 void handle_set_button_pressed() {
@@ -201,20 +374,31 @@ void handle_set_button_pressed() {
 
   selected_field++;
   if (selected_field > FIELD_COUNT) { // finish time adjustment
-    selected_field = NO_FIELD;
-    if (time_changed) {
-      wdt_auto_tune();
-      time_changed = false;
-    } //time changed
-  } // finish time adjustment
+    finish_time_adjust();
+  }
+}
+
+void finish_time_adjust() {
+  selected_field = NO_FIELD;
+  if (time_changed) {
+    wdt_auto_tune();
+#ifdef WATCH_ALARMS
+    alarm_reschedule();
+#endif
+    time_changed = false;
+  } //time changed
 }
 
 void handle_adjust_button_pressed(long value) {
   if (selected_field == NO_FIELD) {
-    // toggle display_mode if no field selected
-    display_mode = (display_mode == time_mode) ? debug_mode : time_mode;
+    // cycle display_mode if no field selected, up for the next page, down for the previous
+    if (value > 0) {
+      display_mode = (display_mode == display_mode_count - 1) ? time_mode : (display_mode_t)(display_mode + 1);
+    } else {
+      display_mode = (display_mode == time_mode) ? (display_mode_t)(display_mode_count - 1) : (display_mode_t)(display_mode - 1);
+    }
   } else {
-    long adjust_value;
+    long adjust_value = 0;
     if (selected_field == YEAR_FIELD) {
       // TODO: handle leap year and reverse value
       adjust_value = value * SECS_PER_DAY * (leapYear(CalendarYrToTm(year())) ? 366 : 365);
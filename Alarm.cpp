@@ -0,0 +1,149 @@
+/*
+ * Alarms and timers, see Alarm.h
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <EEPROM.h>
+#include "Alarm.h"
+
+#ifdef WATCH_ALARMS
+
+#define NO_DEADLINE 0xFFFFFFFF
+
+typedef struct {
+  uint32_t when; // seconds after midnight for a daily alarm, else the end time
+  uint8_t kind;
+  uint8_t check;
+} __attribute__((packed)) alarm_record_t;
+
+static_assert(sizeof(alarm_record_t) == ALARM_RECORD, "alarm record size");
+static_assert(ALARM_ADDR + (ALARM_SLOTS * ALARM_RECORD) <= E2END + 1, "alarm list past the end of the EEPROM");
+
+static alarm_record_t records[ALARM_SLOTS]; // copy of the EEPROM list, written back in background
+static time_t armed_at = 0; // deadlines were worked out from this time
+
+static uint8_t alarm_check(const alarm_record_t &record) {
+  const uint8_t *bytes = (const uint8_t *)&record;
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < ALARM_RECORD - 1; i++) {
+    sum = ((sum << 1) | (sum >> 7)) + bytes[i]; // rotate, so swapped bytes change it
+  }
+  return ~sum; // an erased record does not match its check
+}
+
+// next time a slot goes off after ref
+static time_t slot_deadline(const alarm_record_t &record, time_t ref) {
+  if (record.kind != ALARM_DAILY) return record.when;
+  time_t t = previousMidnight(ref) + record.when;
+  if (t <= ref) t += SECS_PER_DAY;
+  return t;
+}
+
+// hand the earliest deadline after ref to ISR(WDT_vect)
+static void arm(time_t ref) {
+  time_t earliest = NO_DEADLINE;
+  for (uint8_t i = 0; i < ALARM_SLOTS; i++) {
+    if (records[i].kind == ALARM_FREE) continue;
+    time_t t = slot_deadline(records[i], ref);
+    if (t < earliest) earliest = t;
+  }
+  armed_at = ref;
+  set_deadline(earliest);
+}
+
+static void store(uint8_t slot, uint8_t kind, uint32_t when) {
+  records[slot].when = when;
+  records[slot].kind = kind;
+  records[slot].check = alarm_check(records[slot]);
+}
+
+static void save() {
+  eeprom_write_async(ALARM_ADDR, records, sizeof(records)); // only changed bytes are written
+}
+
+static int8_t add(uint8_t kind, uint32_t when) {
+  for (uint8_t i = 0; i < ALARM_SLOTS; i++) {
+    if (records[i].kind == ALARM_FREE) {
+      store(i, kind, when);
+      save();
+      arm(now());
+      return i;
+    }
+  }
+  return -1;
+}
+
+void alarm_begin() {
+  for (uint8_t i = 0; i < ALARM_SLOTS; i++) {
+    EEPROM.get(ALARM_ADDR + (i * ALARM_RECORD), records[i]);
+    if ((records[i].kind > ALARM_COUNTDOWN) || (records[i].check != alarm_check(records[i]))) {
+      store(i, ALARM_FREE, 0); // erased or never written
+    }
+  }
+  arm(now()); // timers that ended while the power was off go off at the first tick
+}
+
+bool alarm_service() {
+  if (!deadline_reached()) return false;
+
+  time_t t = now();
+  bool fired = false;
+  bool changed = false;
+  for (uint8_t i = 0; i < ALARM_SLOTS; i++) {
+    if (records[i].kind == ALARM_FREE) continue;
+    if (slot_deadline(records[i], armed_at) <= t) {
+      fired = true;
+      if (records[i].kind != ALARM_DAILY) { // timers go off once
+        store(i, ALARM_FREE, 0);
+        changed = true;
+      }
+    }
+  }
+  if (changed) save();
+  arm(t); // daily alarms that went off move to tomorrow
+  return fired;
+}
+
+void alarm_reschedule() {
+  arm(now());
+}
+
+int8_t alarm_set_daily(uint8_t hour, uint8_t minute) {
+  return add(ALARM_DAILY, (hour * SECS_PER_HOUR) + (minute * SECS_PER_MIN));
+}
+
+int8_t alarm_set_timer(uint32_t seconds) {
+  return add(ALARM_TIMER, now() + seconds);
+}
+
+int8_t alarm_set_countdown(uint32_t seconds) {
+  for (uint8_t i = 0; i < ALARM_SLOTS; i++) {
+    if (records[i].kind == ALARM_COUNTDOWN) store(i, ALARM_FREE, 0);
+  }
+  return add(ALARM_COUNTDOWN, now() + seconds);
+}
+
+void alarm_clear(uint8_t slot) {
+  if (slot >= ALARM_SLOTS) return;
+  store(slot, ALARM_FREE, 0);
+  save();
+  arm(now());
+}
+
+uint8_t alarm_kind(uint8_t slot) {
+  return (slot < ALARM_SLOTS) ? records[slot].kind : ALARM_FREE;
+}
+
+uint32_t alarm_countdown_left() {
+  time_t t = now();
+  for (uint8_t i = 0; i < ALARM_SLOTS; i++) {
+    if ((records[i].kind == ALARM_COUNTDOWN) && (records[i].when > t)) return records[i].when - t;
+  }
+  return 0;
+}
+#endif
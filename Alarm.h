@@ -0,0 +1,52 @@
+/*
+ * Alarms and timers: daily alarms, one shot timers and a countdown
+ *
+ * The list is a few fixed slots. Only the earliest deadline is handed to
+ * ISR(WDT_vect) (set_deadline() in WDT_Time.h), so a tick costs one 32-bit
+ * compare however many alarms are set; the list is only walked when that
+ * deadline is reached or the list or the time changes.
+ *
+ * Daily alarms keep their time of day and follow the clock when it is set,
+ * timers and the countdown keep their end time. While the display is off the
+ * WDT tick is WDT_SLEEP_INTERVAL long, an alarm is noticed up to that late.
+ *
+ * The list is kept in EEPROM at ALARM_ADDR, after the journal, written in
+ * background when it changes; a daily alarm going off writes nothing.
+ *
+ * Nothing on the watch sets an alarm yet, so the module is built only with
+ * WATCH_ALARMS defined; without it the journal takes the EEPROM of the list
+ * and the WDT tick has no deadline to compare. EEPROM_Journal.cpp and
+ * WDT_Time.cpp include this header for the switch.
+ */
+#ifndef _Alarm_h
+#define _Alarm_h
+
+//#define WATCH_ALARMS
+
+#include <inttypes.h>
+#include "WDT_Time.h"
+#include "EEPROM_Journal.h"
+
+#ifndef ALARM_SLOTS
+#define ALARM_SLOTS 4
+#endif
+#define ALARM_RECORD 6 // time, kind and check
+#define ALARM_ADDR JOURNAL_END // up to the end of the EEPROM
+
+// slot kinds
+#define ALARM_FREE 0
+#define ALARM_DAILY 1 // every day at a time of day
+#define ALARM_TIMER 2 // once, at an end time
+#define ALARM_COUNTDOWN 3 // a timer whose time left is shown, one at most
+
+void alarm_begin(); // read the list from EEPROM, after init_time()
+bool alarm_service(); // call from loop(), true when an alarm went off
+void alarm_reschedule(); // the time was set, daily alarms move with it
+int8_t alarm_set_daily(uint8_t hour, uint8_t minute); // slot, -1 if the list is full
+int8_t alarm_set_timer(uint32_t seconds); // ends seconds from now, slot or -1
+int8_t alarm_set_countdown(uint32_t seconds); // replaces the running countdown, slot or -1
+void alarm_clear(uint8_t slot);
+uint8_t alarm_kind(uint8_t slot);
+uint32_t alarm_countdown_left(); // seconds, 0 when no countdown runs
+
+#endif
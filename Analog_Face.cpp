@@ -0,0 +1,184 @@
+/*
+ * Analog watch face, see Analog_Face.h
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <avr/pgmspace.h>
+#include "Analog_Face.h"
+
+#ifdef WATCH_ANALOG_FACE
+
+#define HANDS 3 // hour, minute, second
+#define TICKS 12
+
+/* sine of a quarter turn in 60ths of a turn, in 255ths, worked out by the compiler
+ * with a Taylor series up to x^15 (error below 1e-7 up to pi / 2)
+ */
+constexpr double sin_series(double x2, double term, uint8_t n) {
+  return (n > 15) ? 0 : term + sin_series(x2, -term * x2 / ((n + 1) * (n + 2)), n + 2);
+}
+constexpr double turn_60ths(uint8_t pos) {
+  return pos * 3.14159265358979 / 30;
+}
+constexpr uint8_t sine_q8(uint8_t pos) {
+  return (uint8_t)((sin_series(turn_60ths(pos) * turn_60ths(pos), turn_60ths(pos), 1) * 255) + 0.5);
+}
+static_assert((sine_q8(0) == 0) && (sine_q8(10) == 221) && (sine_q8(15) == 255), "sine table");
+
+#define SINE_ROW(pos) sine_q8(pos), sine_q8(pos + 1), sine_q8(pos + 2), sine_q8(pos + 3)
+static const uint8_t sine_table[16] PROGMEM = {
+  SINE_ROW(0), SINE_ROW(4), SINE_ROW(8), SINE_ROW(12)
+};
+
+// x offset of a tip at pos, clockwise from 12 o'clock, the y offset is the one of pos + 15
+constexpr int8_t tip_offset(uint8_t pos, uint8_t length) {
+  return (pos >= 30) ? -tip_offset(pos - 30, length)
+         : ((pos > 15) ? tip_offset(30 - pos, length) : (int8_t)(((length * sine_q8(pos)) + 128) >> 8));
+}
+
+// tick dots, constant so all in flash
+#define TICK(pos) ANALOG_FACE_CX + tip_offset(pos, ANALOG_FACE_RADIUS), \
+                  ANALOG_FACE_CY - tip_offset(((pos) + 15) % 60, ANALOG_FACE_RADIUS)
+static const int8_t ticks[TICKS * 2] PROGMEM = {
+  TICK(0), TICK(5), TICK(10), TICK(15), TICK(20), TICK(25),
+  TICK(30), TICK(35), TICK(40), TICK(45), TICK(50), TICK(55)
+};
+
+static const uint8_t hand_length[HANDS] = {ANALOG_HOUR_HAND, ANALOG_MINUTE_HAND, ANALOG_SECOND_HAND};
+static uint8_t drawn_pos[HANDS]; // hand positions on screen
+static bool face_drawn = false;
+
+// tip_offset() from the table at run time
+static int8_t hand_offset(uint8_t pos, uint8_t length) {
+  bool negative = (pos >= 30);
+  if (negative) pos -= 30;
+  if (pos > 15) pos = 30 - pos;
+  int8_t offset = (((uint16_t)length * pgm_read_byte(&sine_table[pos])) + 128) >> 8;
+  return negative ? -offset : offset;
+}
+
+static int8_t hand_x(uint8_t pos, uint8_t length) {
+  return ANALOG_FACE_CX + hand_offset(pos, length);
+}
+
+static int8_t hand_y(uint8_t pos, uint8_t length) {
+  pos += 15;
+  if (pos >= 60) pos -= 60;
+  return ANALOG_FACE_CY - hand_offset(pos, length);
+}
+
+// Bresenham walk of a hand from its left end, x never decreases
+typedef struct {
+  int8_t x, y; // next point
+  int8_t x1, y1; // last point
+  int8_t dx, dy, sy, err;
+  bool done;
+} hand_walk_t;
+
+static void walk_start(hand_walk_t &walk, uint8_t pos, uint8_t length) {
+  int8_t x0 = ANALOG_FACE_CX, y0 = ANALOG_FACE_CY;
+  int8_t x1 = hand_x(pos, length), y1 = hand_y(pos, length);
+  if (x1 < x0) {
+    walk.x = x1; walk.y = y1; walk.x1 = x0; walk.y1 = y0;
+  } else {
+    walk.x = x0; walk.y = y0; walk.x1 = x1; walk.y1 = y1;
+  }
+  walk.dx = walk.x1 - walk.x;
+  walk.sy = (walk.y < walk.y1) ? 1 : -1;
+  walk.dy = (walk.y < walk.y1) ? walk.y - walk.y1 : walk.y1 - walk.y;
+  walk.err = walk.dx + walk.dy;
+  walk.done = false;
+}
+
+static void walk_step(hand_walk_t &walk) {
+  if ((walk.x == walk.x1) && (walk.y == walk.y1)) {
+    walk.done = true;
+    return;
+  }
+  int8_t e2 = 2 * walk.err;
+  if (e2 >= walk.dy) {
+    walk.err += walk.dy;
+    walk.x++;
+  }
+  if (e2 <= walk.dx) {
+    walk.err += walk.dx;
+    walk.y += walk.sy;
+  }
+}
+
+// grow the rectangle to the hand at pos
+static void extend(int8_t *area, uint8_t pos, uint8_t length) {
+  int8_t x = hand_x(pos, length), y = hand_y(pos, length);
+  if (x < area[0]) area[0] = x;
+  if (x > area[1]) area[1] = x;
+  if (y < area[2]) area[2] = y;
+  if (y > area[3]) area[3] = y;
+}
+
+void analog_face_reset() {
+  face_drawn = false;
+}
+
+void analog_face_draw(SSD1306 &oled, const tmElements_t &tm) {
+  uint8_t hour = tm.Hour;
+  if (hour >= 12) hour -= 12;
+  uint8_t pos[HANDS] = {(uint8_t)((hour * 5) + (tm.Minute / 12)), tm.Minute, tm.Second};
+
+  // left, right, top and bottom of what changes, the hands all start at the center
+  int8_t area[4] = {ANALOG_FACE_CX, ANALOG_FACE_CX, ANALOG_FACE_CY, ANALOG_FACE_CY};
+  bool changed = !face_drawn;
+  if (changed) {
+    area[0] = ANALOG_FACE_CX - ANALOG_FACE_RADIUS;
+    area[1] = ANALOG_FACE_CX + ANALOG_FACE_RADIUS;
+    area[2] = ANALOG_FACE_CY - ANALOG_FACE_RADIUS;
+    area[3] = ANALOG_FACE_CY + ANALOG_FACE_RADIUS;
+  } else {
+    for (uint8_t h = 0; h < HANDS; h++) {
+      if (pos[h] != drawn_pos[h]) {
+        extend(area, drawn_pos[h], hand_length[h]); // columns it left
+        extend(area, pos[h], hand_length[h]); // columns it entered
+        changed = true;
+      }
+    }
+  }
+  if (!changed) return;
+
+  hand_walk_t walks[HANDS];
+  for (uint8_t h = 0; h < HANDS; h++) {
+    walk_start(walks[h], pos[h], hand_length[h]);
+    drawn_pos[h] = pos[h];
+  }
+  face_drawn = true;
+
+  uint8_t first_page = area[2] >> 3;
+  uint8_t pages = (area[3] >> 3) - first_page + 1;
+  oled.set_column_area(area[0], first_page, area[1] - area[0] + 1, pages);
+  for (int8_t x = area[0]; x <= area[1]; x++) {
+    // rows of this column, first_page upwards
+    uint8_t column[PAGES];
+    memset(column, 0, pages);
+    for (uint8_t h = 0; h < HANDS; h++) {
+      hand_walk_t &walk = walks[h];
+      while ((!walk.done) && (walk.x <= x)) {
+        uint8_t p = (walk.y >> 3) - first_page;
+        if ((walk.x == x) && (p < pages)) column[p] |= 1 << (walk.y & 7);
+        walk_step(walk);
+      }
+    }
+    for (uint8_t t = 0; t < TICKS * 2; t += 2) {
+      if ((int8_t)pgm_read_byte(&ticks[t]) == x) {
+        int8_t y = pgm_read_byte(&ticks[t + 1]);
+        uint8_t p = (y >> 3) - first_page;
+        if (p < pages) column[p] |= 1 << (y & 7);
+      }
+    }
+    for (uint8_t p = 0; p < pages; p++) oled.ssd1306_send_data_byte(column[p]);
+  }
+  oled.flush();
+}
+#endif
@@ -0,0 +1,31 @@
+/*
+ * Analog watch face: hour, minute and second hands over 12 tick dots
+ *
+ * Hand tips come from a sine table the compiler works out, so there is no
+ * trig or floating point at run time. The hands are rasterized a column at a
+ * time straight into the display stream, and only the rectangle the moving
+ * hands left or entered is sent again: a second on the face costs a few
+ * columns of one or two pages.
+ *
+ * The face is a display page of the watch by define WATCH_ANALOG_FACE.
+ */
+#ifndef _Analog_Face_h
+#define _Analog_Face_h
+
+//#define WATCH_ANALOG_FACE
+
+#include "ssd1306.h"
+#include "WDT_Time.h"
+
+// face in the middle of the panel, as high as it is
+#define ANALOG_FACE_CX ((WIDTH / 2) - 1)
+#define ANALOG_FACE_CY ((PAGES * 4) - 1)
+#define ANALOG_FACE_RADIUS ((PAGES * 4) - 1) // tick dots
+#define ANALOG_SECOND_HAND (ANALOG_FACE_RADIUS - 2)
+#define ANALOG_MINUTE_HAND (ANALOG_FACE_RADIUS - 3)
+#define ANALOG_HOUR_HAND ((ANALOG_FACE_RADIUS / 2) + 1)
+
+void analog_face_draw(SSD1306 &oled, const tmElements_t &tm); // the whole face the first time, then what moved
+void analog_face_reset(); // the screen was cleared, draw the whole face next time
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Button decoder for the resistor ladder, see Button.h
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include "Button.h"
+#include "Energy.h"
+
+static volatile bool button_sample_now = false; // pin change since the last sample
+static uint32_t sample_millis = 0;
+static button_t candidate = button_none; // level of the latest samples
+static uint8_t candidate_count = 0;
+static button_t stable = button_none; // debounced level
+#ifdef WATCH_BUTTON_REPEAT
+static bool hold_ignored = false; // the press that woke the watch
+static bool long_sent = false;
+static uint32_t press_millis = 0;
+static uint32_t repeat_millis = 0; // time of the next repeat
+static uint16_t repeat_interval = BUTTON_REPEAT_START_MS;
+#endif
+
+static button_t read_ladder() {
+  ENERGY_COUNT(adc_conversions);
+  int value = analogRead(BUTTONPIN);
+  if (value >= PRESSED_BUTTON_THRESHOLD) return button_none;
+  if (value > UP_DOWN_BUTTON_THRESHOLD) return button_down;
+  if (value > SET_UP_BUTTON_THRESHOLD) return button_up;
+  return button_set;
+}
+
+button_event_t button_poll(button_t &button) {
+  uint32_t ms = millis();
+  if (!button_sample_now && ((ms - sample_millis) < BUTTON_SAMPLE_MS)) return button_no_event;
+  button_sample_now = false;
+  sample_millis = ms;
+
+  button_t level = read_ladder();
+  if (level != candidate) {
+    candidate = level;
+    candidate_count = 1;
+  } else if (candidate_count < BUTTON_DEBOUNCE_SAMPLES) {
+    candidate_count++;
+  }
+  if (candidate_count < BUTTON_DEBOUNCE_SAMPLES) return button_no_event; // bouncing
+
+  button = stable;
+  if (level != stable) { // debounced change
+    stable = level;
+    button = level;
+    if (level == button_none) return button_no_event; // released
+#ifdef WATCH_BUTTON_REPEAT
+    hold_ignored = false;
+    press_millis = ms;
+    repeat_millis = ms + BUTTON_REPEAT_DELAY_MS;
+    repeat_interval = BUTTON_REPEAT_START_MS;
+    long_sent = false;
+#endif
+    return button_press;
+  }
+
+#ifdef WATCH_BUTTON_REPEAT
+  if ((stable == button_none) || hold_ignored) return button_no_event;
+  if (!long_sent && ((ms - press_millis) >= BUTTON_LONG_PRESS_MS)) {
+    long_sent = true;
+    return button_long_press;
+  }
+  if ((int32_t)(ms - repeat_millis) >= 0) {
+    repeat_millis += repeat_interval;
+    repeat_interval -= repeat_interval >> 2; // accelerate
+    if (repeat_interval < BUTTON_REPEAT_MIN_MS) repeat_interval = BUTTON_REPEAT_MIN_MS;
+    return button_repeat;
+  }
+#endif
+  return button_no_event;
+}
+
+bool button_wake() {
+  button_t level = read_ladder();
+  if (level == button_none) return false;
+  // wake on the first sample, the held press is taken as debounced and gives no events
+  candidate = stable = level;
+  candidate_count = BUTTON_DEBOUNCE_SAMPLES;
+#ifdef WATCH_BUTTON_REPEAT
+  hold_ignored = true;
+#endif
+  sample_millis = millis();
+  return true;
+}
+
+void button_changed() {
+  button_sample_now = true;
+}
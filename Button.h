@@ -0,0 +1,46 @@
+/*
+ * Button decoder for the resistor ladder on BUTTONPIN
+ * Debounced press, long press and accelerating auto-repeat events; the long
+ * press and the repeat are about 400 bytes of flash, so they are only built by
+ * define WATCH_BUTTON_REPEAT, without it a press gives one event.
+ * The ladder is sampled every BUTTON_SAMPLE_MS from loop() and at once after a
+ * pin change, button_changed() is called by ISR(PCINT0_vect).
+ * Only a ladder level below the pin's logic threshold raises a pin change, the
+ * set button does; a level above it is seen at the next sample or WDT tick,
+ * while asleep that is the WDT_SLEEP_INTERVAL tick of WDT_Time.h.
+ */
+#ifndef _Button_h
+#define _Button_h
+
+#include <inttypes.h>
+
+//#define WATCH_BUTTON_REPEAT
+
+#define BUTTONPIN  3
+
+#define SET_UP_BUTTON_THRESHOLD 100
+#define UP_DOWN_BUTTON_THRESHOLD 600
+#define PRESSED_BUTTON_THRESHOLD 1000
+
+#ifndef BUTTON_SAMPLE_MS
+#define BUTTON_SAMPLE_MS 5 // ladder sample interval while awake
+#endif
+#define BUTTON_DEBOUNCE_SAMPLES 3 // same level this many samples in a row
+#define BUTTON_LONG_PRESS_MS 1000
+#define BUTTON_REPEAT_DELAY_MS 500 // first repeat
+#define BUTTON_REPEAT_START_MS 250 // then repeats faster by a quarter each time
+#define BUTTON_REPEAT_MIN_MS 80
+
+typedef enum {
+  button_none, button_set, button_up, button_down
+} button_t;
+
+typedef enum {
+  button_no_event, button_press, button_long_press, button_repeat
+} button_event_t;
+
+button_event_t button_poll(button_t &button); // call from loop(), the button of the event in button
+bool button_wake(); // while sleeping: true if a button is down now, that press gives no events
+void button_changed(); // call from ISR(PCINT0_vect)
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * EEPROM journal and background writer, see EEPROM_Journal.h
+ * Ref.: ATtiny85 data sheet 5.5 EEPROM Data Memory
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <EEPROM.h>
+#include "Alarm.h" // WATCH_ALARMS, the journal ends at the alarm list
+#include "EEPROM_Journal.h"
+#include "Energy.h"
+
+#ifndef cbi
+#define cbi(sfr, bit) (_SFR_BYTE(sfr) &= ~_BV(bit))
+#endif
+#ifndef sbi
+#define sbi(sfr, bit) (_SFR_BYTE(sfr) |= _BV(bit))
+#endif
+
+#ifdef WATCH_JOURNAL
+
+// background writes, a ring of descriptors served by ISR(EE_RDY_vect)
+typedef struct {
+  uint16_t addr;
+  const uint8_t *src;
+  uint8_t len;
+  uint8_t done; // bytes checked so far
+} eeprom_job_t;
+
+static eeprom_job_t queue[EEPROM_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;
+static volatile uint8_t queue_count = 0;
+
+// journal record, the sequence number is written last
+typedef struct {
+  uint8_t payload[JOURNAL_PAYLOAD];
+  uint16_t check;
+  uint16_t seq;
+} journal_record_t;
+
+static journal_record_t journal_record; // being written
+static uint8_t journal_next[JOURNAL_PAYLOAD]; // appended while journal_record is still being written
+static volatile bool journal_writing = false;
+static volatile bool journal_pending = false;
+static uint8_t journal_slot = JOURNAL_SLOTS - 1; // slot of the newest record
+static uint16_t journal_seq = 0; // its sequence number
+
+static uint16_t journal_check(const journal_record_t &record) {
+  uint16_t sum = record.seq;
+  for (uint8_t i = 0; i < JOURNAL_PAYLOAD; i++) {
+    sum = ((sum << 1) | (sum >> 15)) + record.payload[i]; // rotate, so swapped bytes change it
+  }
+  return ~sum; // an erased record does not match its check
+}
+
+static uint16_t journal_slot_addr(uint8_t slot) {
+  return JOURNAL_ADDR + (slot * JOURNAL_RECORD);
+}
+
+static uint16_t read_seq(uint8_t slot) {
+  uint16_t seq;
+  EEPROM.get(journal_slot_addr(slot) + JOURNAL_PAYLOAD + 2, seq);
+  return seq;
+}
+
+// add a job, or restart the queued one of the same source so it writes the latest bytes
+// call with interrupts disabled
+static bool queue_push(uint16_t addr, const uint8_t *src, uint8_t len) {
+  for (uint8_t i = 0; i < queue_count; i++) {
+    eeprom_job_t *job = &queue[(queue_head + i) % EEPROM_QUEUE_SIZE];
+    if (job->src == src) {
+      job->addr = addr;
+      job->len = len;
+      job->done = 0;
+      return true;
+    }
+  }
+  if (queue_count >= EEPROM_QUEUE_SIZE) return false;
+  eeprom_job_t *job = &queue[(queue_head + queue_count) % EEPROM_QUEUE_SIZE];
+  job->addr = addr;
+  job->src = src;
+  job->len = len;
+  job->done = 0;
+  queue_count++;
+  return true;
+}
+
+// next record after the newest one, call with interrupts disabled
+static void journal_stage(const uint8_t *payload) {
+  if (++journal_slot >= JOURNAL_SLOTS) journal_slot = 0;
+  journal_seq++;
+  memcpy(journal_record.payload, payload, JOURNAL_PAYLOAD);
+  journal_record.seq = journal_seq;
+  journal_record.check = journal_check(journal_record);
+  queue_push(journal_slot_addr(journal_slot), (const uint8_t *)&journal_record, JOURNAL_RECORD);
+  journal_writing = true;
+}
+
+bool journal_read(void *payload) {
+  // the slots from 0 hold consecutive sequence numbers up to the newest record,
+  // older or erased ones after it, find the end of that run
+  uint16_t first = read_seq(0);
+  uint8_t low = 0; // always in the run
+  uint8_t high = JOURNAL_SLOTS - 1;
+  while (low < high) {
+    uint8_t mid = (low + high + 1) / 2;
+    if (read_seq(mid) == (uint16_t)(first + mid)) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+
+  // the newest record, or the one before if a power loss cut it
+  journal_record_t record;
+  for (uint8_t i = 0; i < 2; i++) {
+    EEPROM.get(journal_slot_addr(low), record);
+    if (record.check == journal_check(record)) {
+      memcpy(payload, record.payload, JOURNAL_PAYLOAD);
+      journal_slot = low;
+      journal_seq = record.seq;
+      return true;
+    }
+    low = (low ? low : JOURNAL_SLOTS) - 1;
+  }
+  journal_slot = JOURNAL_SLOTS - 1; // empty, the first append goes to slot 0
+  journal_seq = 0;
+  return false;
+}
+
+void journal_append(const void *payload) {
+  cli();
+  if (journal_writing) { // write it after the current one
+    memcpy(journal_next, payload, JOURNAL_PAYLOAD);
+    journal_pending = true;
+  } else {
+    journal_stage((const uint8_t *)payload);
+  }
+  sbi(EECR, EERIE); // served once the EEPROM is ready
+  sei();
+}
+
+bool eeprom_write_async(uint16_t addr, const void *src, uint8_t len) {
+  cli();
+  bool queued = queue_push(addr, (const uint8_t *)src, len);
+  sbi(EECR, EERIE);
+  sei();
+  return queued;
+}
+
+bool eeprom_busy() {
+  return queue_count != 0;
+}
+
+// EEPROM ready, start the next byte that differs from what is stored
+ISR(EE_RDY_vect) {
+  while (queue_count) {
+    eeprom_job_t *job = &queue[queue_head];
+    while (job->done < job->len) {
+      uint16_t addr = job->addr + job->done;
+      uint8_t data = job->src[job->done++];
+      EEAR = addr;
+      sbi(EECR, EERE);
+      if (EEDR != data) {
+        EEDR = data;
+        ENERGY_COUNT(eeprom_writes);
+        sbi(EECR, EEMPE); // erase and write, EEPM bits are 0
+        sbi(EECR, EEPE);
+        return; // interrupt again when the write is done
+      }
+    }
+    queue_head = (queue_head + 1) % EEPROM_QUEUE_SIZE;
+    queue_count--;
+    if (job->src == (const uint8_t *)&journal_record) {
+      journal_writing = false;
+      if (journal_pending) {
+        journal_pending = false;
+        journal_stage(journal_next);
+      }
+    }
+  }
+  cbi(EECR, EERIE); // all written
+}
+
+#else // WATCH_JOURNAL
+// only the changed bytes, each waits for the EEPROM
+bool eeprom_write_async(uint16_t addr, const void *src, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++) {
+    uint8_t data = ((const uint8_t *)src)[i];
+    if (EEPROM.read(addr + i) != data) {
+      EEPROM.write(addr + i, data);
+      ENERGY_COUNT(eeprom_writes);
+    }
+  }
+  return true;
+}
+
+bool eeprom_busy() {
+  return false;
+}
+#endif // WATCH_JOURNAL
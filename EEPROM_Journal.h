@@ -0,0 +1,59 @@
+/*
+ * EEPROM journal and background writer
+ *
+ * Bytes are written by the EEPROM ready interrupt, one at a time, so the caller
+ * never waits the 3.4 ms of a cell write. Only changed bytes are written.
+ *
+ * The journal spreads a small record over a ring of slots, each write goes to
+ * the next slot with the next sequence number, so no cell wears faster than the
+ * others. At boot the newest record is found by a binary search over the
+ * sequence numbers. The sequence number is the last field written, a record cut
+ * by a power loss is not taken as newest, the one before it is used instead.
+ *
+ * EEPROM map: 0 - 7 old time record (TIME_ADDR), 8 - 23 WDT drift table
+ * (DRIFT_ADDR), 24 - 31 free, 32 - 511 journal; with WATCH_ALARMS (Alarm.h)
+ * 32 - 487 journal, 488 - 511 alarm list (ALARM_ADDR).
+ *
+ * The journal and the background writer take about 1 KB of flash, so they are
+ * built only with WATCH_JOURNAL defined. Without it the time record stays at
+ * TIME_ADDR as in older firmware, and eeprom_write_async() writes the changed
+ * bytes before it returns.
+ */
+#ifndef _EEPROM_Journal_h
+#define _EEPROM_Journal_h
+
+//#define WATCH_JOURNAL
+
+#include <inttypes.h>
+
+#ifndef JOURNAL_ADDR
+#define JOURNAL_ADDR 32 // first slot, after the WDT drift table
+#endif
+#ifndef JOURNAL_END
+#ifdef WATCH_ALARMS
+#define JOURNAL_END (E2END + 1 - 24) // ring up to the alarm list at the end of the EEPROM
+#else
+#define JOURNAL_END (E2END + 1)
+#endif
+#endif
+#define JOURNAL_PAYLOAD 8 // bytes of a record, time and WDT calibrate value
+#define JOURNAL_RECORD (JOURNAL_PAYLOAD + 4) // payload, check and sequence number
+#define JOURNAL_SLOTS ((JOURNAL_END - JOURNAL_ADDR) / JOURNAL_RECORD) // 40 on the ATtiny85, 38 with the alarm list
+#ifndef EEPROM_QUEUE_SIZE
+#ifdef WATCH_ALARMS
+#define EEPROM_QUEUE_SIZE 3 // pending writes, one each for the journal, the drift table and the alarm list
+#else
+#define EEPROM_QUEUE_SIZE 2 // pending writes, one each for the journal and the drift table
+#endif
+#endif
+
+#ifdef WATCH_JOURNAL
+bool journal_read(void *payload); // newest record, false if the journal is empty
+void journal_append(const void *payload); // returns at once, written in background
+#endif
+// queued for the ready interrupt with WATCH_JOURNAL, src must stay valid until written;
+// without it this blocks, each changed byte waits ~3.4 ms for the EEPROM before it returns
+bool eeprom_write_async(uint16_t addr, const void *src, uint8_t len);
+bool eeprom_busy(); // background writes not finished, the ready interrupt cannot wake power down
+
+#endif
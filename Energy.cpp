@@ -0,0 +1,62 @@
+/*
+ * Energy accounting, see Energy.h
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <util/atomic.h>
+
+#include "ssd1306.h" // the display transport, for the I2C byte charge
+#include "Energy.h"
+
+#ifdef WATCH_ENERGY
+
+volatile energy_counters_t energy_counters;
+static uint32_t awake_millis = 0; // millis() at the last wake up
+
+void energy_sleep() {
+  energy_counters.awake_ms += millis() - awake_millis;
+}
+
+void energy_wake(bool by_wdt) {
+  awake_millis = millis();
+  if (by_wdt) {
+    energy_counters.wdt_wakes++;
+  } else {
+    energy_counters.button_wakes++;
+  }
+}
+
+uint32_t energy_awake_ms() {
+  return energy_counters.awake_ms + (millis() - awake_millis);
+}
+
+// microcoulomb of count events of nC each, without overflow
+static uint32_t charge_uc(uint32_t count, uint16_t nc) {
+  return ((count / 1000) * nc) + (((count % 1000) * nc) / 1000);
+}
+
+// average current in microampere over seconds
+uint32_t energy_average_ua(uint32_t seconds, uint32_t i2c_bytes, uint32_t i2c_transactions) {
+  if (seconds == 0) return 0;
+  uint32_t awake_s = energy_awake_ms() / 1000;
+  uint32_t sleep_s = (seconds > awake_s) ? (seconds - awake_s) : 0;
+  uint32_t adc_conversions, eeprom_writes, wakes;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { // 32-bit counters an interrupt may be counting
+    adc_conversions = energy_counters.adc_conversions;
+    eeprom_writes = energy_counters.eeprom_writes;
+    wakes = energy_counters.wdt_wakes + energy_counters.button_wakes;
+  }
+
+  uint32_t charge = (sleep_s * ENERGY_SLEEP_UA) + (awake_s * ENERGY_AWAKE_UA); // uC
+  charge += charge_uc(i2c_bytes, ENERGY_I2C_BYTE_NC);
+  charge += charge_uc(i2c_transactions, ENERGY_I2C_TRANSACTION_NC);
+  charge += charge_uc(adc_conversions, ENERGY_ADC_NC);
+  charge += charge_uc(eeprom_writes, ENERGY_EEPROM_WRITE_NC);
+  charge += charge_uc(wakes, ENERGY_WAKE_NC);
+  return charge / seconds;
+}
+#endif // WATCH_ENERGY
@@ -0,0 +1,74 @@
+/*
+ * Energy accounting, activity counters rolled up into an estimated average current
+ * The counters are plain increments, but there is one at every wake up, ADC
+ * conversion, EEPROM byte and frame, so they are counted only by define
+ * WATCH_ENERGY; the watch shows them on a power page by define WATCH_POWER_PAGE,
+ * which counts them too.
+ */
+#ifndef _Energy_h
+#define _Energy_h
+
+//#define WATCH_ENERGY
+//#define WATCH_POWER_PAGE
+
+#if defined(WATCH_POWER_PAGE) && !defined(WATCH_ENERGY)
+#define WATCH_ENERGY
+#endif
+
+#include <inttypes.h>
+
+/* charge of each activity, put your measured values here
+ * currents in microampere, charges per event in nanocoulomb (nA x s)
+ * the I2C byte follows the display transport of ssd1306.h, include it first
+ */
+#ifndef ENERGY_SLEEP_UA
+#define ENERGY_SLEEP_UA 5 // power down, WDT running
+#endif
+#ifndef ENERGY_AWAKE_UA
+#define ENERGY_AWAKE_UA 3000 // CPU active or idle, OLED on
+#endif
+#ifndef ENERGY_I2C_BYTE_NC
+#if defined(SSD1306_TINYWIREM)
+#define ENERGY_I2C_BYTE_NC 90 // 9 SCL clocks at ~100 kHz, ~1 mA above awake
+#elif SSD1306_ASYNC_SEGMENTS > 0
+#define ENERGY_I2C_BYTE_NC 215 // 9 SCL clocks at ~42 kHz from the pump interrupts, ~1 mA above awake
+#else
+#define ENERGY_I2C_BYTE_NC 25 // 9 SCL clocks at 400 kHz, ~1 mA above awake
+#endif
+#endif
+#ifndef ENERGY_I2C_TRANSACTION_NC
+#define ENERGY_I2C_TRANSACTION_NC 40 // start, stop and USI setup
+#endif
+#ifndef ENERGY_ADC_NC
+#define ENERGY_ADC_NC 60 // a conversion, ~0.3 mA for 200 us
+#endif
+#ifndef ENERGY_EEPROM_WRITE_NC
+#define ENERGY_EEPROM_WRITE_NC 10000 // erase and write, ~3 mA for 3.4 ms
+#endif
+#ifndef ENERGY_WAKE_NC
+#define ENERGY_WAKE_NC 50 // wake from power down and back
+#endif
+
+typedef struct {
+  uint32_t awake_ms; // up to the last energy_sleep()
+  uint32_t frames; // draw_oled() calls
+  uint32_t adc_conversions;
+  uint32_t eeprom_writes; // bytes actually written
+  uint32_t wdt_wakes; // wake ups from power down by cause
+  uint32_t button_wakes;
+  uint32_t alarms; // alarms and timers gone off, each wakes the display
+} energy_counters_t;
+
+#ifdef WATCH_ENERGY
+extern volatile energy_counters_t energy_counters; // the ADC and EEPROM ready interrupts count too
+#define ENERGY_COUNT(counter) (energy_counters.counter++)
+
+void energy_sleep(); // before power down
+void energy_wake(bool by_wdt); // after power down
+uint32_t energy_awake_ms();
+uint32_t energy_average_ua(uint32_t seconds, uint32_t i2c_bytes, uint32_t i2c_transactions);
+#else
+#define ENERGY_COUNT(counter) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Write only USI I2C master for the display, see USI_I2C.h
+ * Ref.:
+ * ATtiny85 data sheet 15 USI - Universal Serial Interface
+ * Atmel AVR310: Using the USI module as a I2C master
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <util/delay.h>
+#include "USI_I2C.h"
+
+#define SDA USI_I2C_SDA
+#define SCL USI_I2C_SCL
+#define USICR_IDLE USI_I2C_USICR
+#define USICR_STROBE USI_I2C_STROBE
+// clear the flags and the edge counter
+#define USISR_CLEAR (_BV(USISIF) | _BV(USIOIF) | _BV(USIPF) | _BV(USIDC))
+
+// delay left of a bus time after the cycles the code spends in it, none at low clocks
+#define DELAY_LEFT_US(us, cycles) ((((us) - ((cycles) * 1000000.0 / F_CPU)) > 0) ? ((us) - ((cycles) * 1000000.0 / F_CPU)) : 0)
+#define LOW_DELAY_US DELAY_LEFT_US(USI_I2C_T_LOW_US, 4) // strobe, loop count and branch
+#define HIGH_DELAY_US DELAY_LEFT_US(USI_I2C_T_HIGH_US, 1) // strobe
+
+// clock out bits, the SSD1306 never holds SCL low so no clock stretching wait
+static uint8_t transfer(uint8_t bits) {
+  USISR = USISR_CLEAR; // our START sets USISIF, which holds SCL low until cleared
+  do {
+    _delay_us(LOW_DELAY_US);
+    USICR = USICR_STROBE; // SCL high, the slave samples SDA
+    _delay_us(HIGH_DELAY_US);
+    USICR = USICR_STROBE; // SCL low, USIDR shifts the next bit out
+  } while (--bits);
+  _delay_us(LOW_DELAY_US);
+  uint8_t data = USIDR;
+  USIDR = 0xFF; // release SDA
+  return data;
+}
+
+void usi_i2c_begin() {
+  PORTB |= _BV(SDA) | _BV(SCL); // released, the pins are open drain in two wire mode
+  DDRB |= _BV(SDA) | _BV(SCL);
+  USIDR = 0xFF;
+  USICR = USICR_IDLE;
+  USISR = USISR_CLEAR;
+}
+
+bool usi_i2c_start(uint8_t addr) {
+  PORTB |= _BV(SCL);
+  _delay_us(USI_I2C_T_SU_US);
+  PORTB &= ~_BV(SDA); // SDA falls while SCL high
+  _delay_us(USI_I2C_T_SU_US);
+  PORTB &= ~_BV(SCL);
+  PORTB |= _BV(SDA); // USIDR drives SDA from here
+  return usi_i2c_write(addr << 1); // write direction
+}
+
+bool usi_i2c_write(uint8_t data) {
+  USIDR = data;
+  transfer(8);
+  DDRB &= ~_BV(SDA); // the slave pulls SDA low to acknowledge
+  uint8_t ack = transfer(1);
+  DDRB |= _BV(SDA);
+  return !(ack & 0x01);
+}
+
+void usi_i2c_stop() {
+  PORTB &= ~_BV(SDA);
+  PORTB |= _BV(SCL);
+  _delay_us(USI_I2C_T_SU_US);
+  PORTB |= _BV(SDA); // SDA rises while SCL high
+  _delay_us(USI_I2C_T_BUF_US);
+}
@@ -0,0 +1,43 @@
+/*
+ * Write only USI I2C master for the display
+ *
+ * Each byte is clocked out as soon as it is written, straight from the caller,
+ * so there is no transmit buffer to fill and a transaction can be any length.
+ * SCL runs at fast mode timing (400 kHz) when the CPU is fast enough, at 1 MHz
+ * the strobe loop itself is the limit.
+ *
+ * Pins: SDA PB0, SCL PB2, external pull ups.
+ */
+#ifndef _USI_I2C_h
+#define _USI_I2C_h
+
+#include <inttypes.h>
+
+// bus timing in microseconds, SSD1306 fast mode by default (2.5 us clock cycle),
+// lower them for a panel that takes a faster clock, raise them for a long bus
+#ifndef USI_I2C_T_LOW_US
+#define USI_I2C_T_LOW_US 1.3 // SCL low
+#endif
+#ifndef USI_I2C_T_HIGH_US
+#define USI_I2C_T_HIGH_US 1.2 // SCL high, 0.6 minimum, the rest of the cycle
+#endif
+#ifndef USI_I2C_T_SU_US
+#define USI_I2C_T_SU_US 0.6 // START hold and STOP setup
+#endif
+#ifndef USI_I2C_T_BUF_US
+#define USI_I2C_T_BUF_US 1.3 // bus free between STOP and START
+#endif
+
+// pins and register values, also used by the interrupt driven display pump in ssd1306.cpp
+#define USI_I2C_SDA PB0
+#define USI_I2C_SCL PB2
+// two wire mode, data shifts on the SCL edges, a USITC strobe toggles SCL
+#define USI_I2C_USICR (_BV(USIWM1) | _BV(USICS1) | _BV(USICLK))
+#define USI_I2C_STROBE (USI_I2C_USICR | _BV(USITC))
+
+void usi_i2c_begin();
+bool usi_i2c_start(uint8_t addr); // START and address byte, true if acknowledged
+bool usi_i2c_write(uint8_t data); // true if acknowledged
+void usi_i2c_stop();
+
+#endif
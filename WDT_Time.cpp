@@ -16,8 +16,12 @@
 
 #include <avr/wdt.h>        // Supplied Watch Dog Timer Macros 
 #include <avr/sleep.h>      // Supplied AVR Sleep Macros
+#include <util/atomic.h>    // ATOMIC_BLOCK around the values the WDT ISR writes
 #include <EEPROM.h>
 #include "WDT_Time.h"
+#include "Alarm.h" // WATCH_ALARMS, the deadline of a tick
+#include "EEPROM_Journal.h"
+#include "Energy.h"
 
 // Routines to clear and set bits (used in the sleep code)
 #ifndef cbi
@@ -27,23 +31,106 @@
 #define sbi(sfr, bit) (_SFR_BYTE(sfr) |= _BV(bit))
 #endif
 
-static tmElements_t tm;          // a cache of time elements
-static time_t cacheTime;   // the time the cache was updated
+static tmElements_t tm = {0, 0, 0, 5, 1, 1, 0}; // a cache of time elements, start at 1970-01-01 (Thursday)
+static time_t cacheTime = 0;   // the time the cache was updated
 
-static uint32_t sysTime = 0;
-static uint32_t prev_microsecond = 0;
+// the time is whole seconds plus the phase into the running second, in Q8.24 seconds,
+// ISR(WDT_vect) adds the tick to the phase and carries whole seconds with a shift
+#define PHASE_SECOND (1UL << 24)
+static volatile uint32_t sysTime = 0;
+static volatile uint32_t time_phase = 0; // below PHASE_SECOND
 static timeStatus_t Status = timeNotSet;
 
-static uint32_t wdt_microsecond = 0;
 static uint32_t prev_sysTime = 0;
+uint32_t wdt_microsecond_per_interrupt = DEFAULT_WDT_MICROSECOND; // calibrate value, average of all conditions
+static volatile uint32_t wdt_interrupt_count = 0; // 32 bits written by ISR(WDT_vect), read with get_wdt_interrupt_count()
+static volatile uint32_t uptime_seconds = 0; // WDT seconds since power on, never reset
+#ifdef WATCH_ALARMS
+static volatile uint32_t deadline = 0xFFFFFFFF; // earliest alarm (Alarm.h), none by default
+static volatile bool deadline_flag = false;
+#endif
+// calibrate value for the current temperature and Vcc, and the same in Q8.24 seconds, the one ISR(WDT_vect) adds
+static uint32_t wdt_active_microsecond = DEFAULT_WDT_MICROSECOND;
+static volatile uint32_t wdt_active_phase = 0;
+
+#ifdef WATCH_DRIFT_TABLE
+// WDT drift table, one calibrate value per temperature x Vcc bucket, learned by wdt_auto_tune()
+#define DRIFT_BUCKETS (DRIFT_TEMP_BUCKETS * DRIFT_VCC_BUCKETS)
+#define DRIFT_UNSET 0xFFFF // erased EEPROM, bucket not learned yet
+static uint16_t drift_table[DRIFT_BUCKETS]; // copy of the EEPROM table, written back in background
+static uint8_t drift_bucket = 0xFF; // bucket of the latest sensor values
+static uint8_t drift_time[DRIFT_BUCKETS]; // time spent in each bucket since last tune, in DRIFT_SLEEP_SAMPLE seconds
+static uint32_t drift_since = 0; // wdt_interrupt_count counted into drift_time, the part of a unit left is carried
+static void updateSensorValues();
+#endif
+
+// WDT prescaler, the long one is only used while sleeping, built only when
+// WDT_SLEEP_INTERVAL is set longer than WDT_INTERVAL
+#if WDT_SLEEP_INTERVAL > WDT_INTERVAL
+static volatile uint8_t wdt_interval = WDT_INTERVAL; // prescaler of the running tick
+static volatile uint8_t wdt_next_interval = WDT_INTERVAL; // prescaler from the next tick
+static volatile bool wdt_catch_up = false; // woken before the running long tick ends
+static uint32_t wake_millis = 0;
+#endif
+
+// ADC sampling rounds
+#define VCC_ADMUX (_BV(MUX3) | _BV(MUX2)) // 1.1V reference against AVcc
+#define TEMP_ADMUX (0xF | _BV(REFS1)) // ADC4 (Temp Sensor) and Ref voltage = 1.1V
+#define ADC_SETTLE_MS 2 // Wait for Vref to settle after switching
+#ifdef WATCH_ADC_INTERRUPT
+typedef enum {
+  adc_idle, adc_settle_vcc, adc_convert_vcc, adc_settle_temp, adc_convert_temp, adc_ready
+} adc_state_t;
+static volatile adc_state_t adc_state = adc_idle;
+static volatile uint32_t adc_settle_millis = 0; // start of the reference settle wait
+#endif
+static uint32_t adc_round_millis = 0; // start of the last sampling round
+static volatile uint16_t accumulatedRawVcc = 0;
+static volatile uint16_t accumulatedRawTemp = 0;
+static uint32_t cachedVcc = 0; // millivolts
+static int32_t cachedTemp = 0; // milli degree Celsius
+
+#ifdef WATCH_CACHE_STEP
+// move the cache forward by less than a minute, carry into the upper fields
+static void advanceCache(uint8_t seconds) {
+  tm.Second += seconds;
+  if (tm.Second < 60) return;
+  tm.Second -= 60;
+  if (++tm.Minute < 60) return;
+  tm.Minute = 0;
+  if (++tm.Hour < 24) return;
+  tm.Hour = 0;
+  if (++tm.Wday > 7) tm.Wday = 1;
+  if (++tm.Day <= getMonthDays(tm.Year, tm.Month)) return;
+  tm.Day = 1;
+  if (++tm.Month <= 12) return;
+  tm.Month = 1;
+  tm.Year++;
+}
+#endif
 
 void refreshCache(time_t t) {
   if (t != cacheTime) {
+#ifdef WATCH_CACHE_STEP
+    if ((t > cacheTime) && ((uint32_t)(t - cacheTime) < SECS_PER_MIN)) {
+      advanceCache(t - cacheTime); // usual case, a few seconds since last call
+    } else {
+      breakTime(t, tm); // large or backward jump, e.g. adjustTime()
+    }
+#else
     breakTime(t, tm);
+#endif
     cacheTime = t;
   }
 }
 
+time_t nowElements(tmElements_t &elements) {
+  time_t t = now();
+  refreshCache(t);
+  elements = tm;
+  return t;
+}
+
 uint8_t hour() { // the hour now
   return hour(now());
 }
@@ -137,32 +224,73 @@ uint16_t year(time_t t) { // the year for the given time
   return tmYearToCalendar(tm.Year);
 }
 
+// year offset from 1970, in time_t range (1970 - 2106) only 2100 break the 4 years rule
 bool leapYear(uint16_t y) {
-  return !((1970 + y) % 4) && ( ((1970 + y) % 100) || !((1970 + y) % 400) );
+  return !((1970 + y) & 3) && (y != (2100 - 1970));
 }
 
 uint8_t getMonthDays(uint16_t y, uint8_t m) {
   return ((m == 2) && leapYear(y)) ? 29 : monthDays[m - 1];
 }
 
-uint16_t getYearDays(uint16_t y) {
-  return leapYear(y) ? 366 : 365;
-}
-
 
 /*============================================================================*/
 /* functions to convert to and from system time */
 /* These are for interfacing with time serivces and are not normally needed in a sketch */
 
+// Days are counted from 1968-03-01, so each 4 years cycle ends with its leap day
+// and a month number counted from March gives the days before it by a formula.
+// Only 2100 break the 4 years rule in time_t range (1970 - 2106), 2000 is a leap year.
+// Divisions by constants are done by multiply and shift, exact over the ranges used.
+#define DAYS_1968_03_01_TO_1970 671
+#define DAYS_1970_TO_2100_03_01 47541
+
+// days before the month, month counted from March (0 - 11): (153 * m + 2) / 5
+static uint16_t daysBeforeMonth(uint8_t m) {
+  return ((uint32_t)(153U * m + 2) * 1639UL) >> 13;
+}
+
+// days since 1970-01-01 (0 - 49710) to date
+static void civilFromDays(uint16_t days, tmElements_t &tm) {
+  uint16_t n = days + DAYS_1968_03_01_TO_1970;
+  if (days >= DAYS_1970_TO_2100_03_01) n++; // skip the 2100-02-29 the 4 years cycle assume
+  uint8_t cycle = ((uint32_t)n * 22967UL) >> 25; // n / 1461
+  uint16_t dayOfCycle = n - ((uint16_t)cycle * 1461U); // int is 16 bits on the AVR, cycle * 1461 is not
+  uint8_t yearOfCycle = ((uint32_t)dayOfCycle * 1437UL) >> 19; // dayOfCycle / 365
+  if (yearOfCycle > 3) yearOfCycle = 3; // the leap day
+  uint16_t dayOfYear = dayOfCycle - ((uint16_t)yearOfCycle * 365U);
+  uint8_t m = ((uint32_t)(5U * dayOfYear + 2) * 857UL) >> 17; // (5 * dayOfYear + 2) / 153
+
+  tm.Day = dayOfYear - daysBeforeMonth(m) + 1;
+  if (m < 10) {
+    tm.Month = m + 3;
+    tm.Year = ((uint16_t)cycle * 4U) + yearOfCycle - 2; // year is offset from 1970
+  } else { // January and February belong to next year
+    tm.Month = m - 9;
+    tm.Year = ((uint16_t)cycle * 4U) + yearOfCycle - 1;
+  }
+}
+
+// date to days since 1970-01-01
+static uint16_t daysFromCivil(const tmElements_t &tm) {
+  uint16_t y = tm.Year + 2; // years since 1968
+  uint8_t m = tm.Month;
+  if (m > 2) {
+    m -= 3;
+  } else { // January and February belong to previous year
+    m += 9;
+    y--;
+  }
+  uint16_t days = (y * 365U) + (y >> 2) + daysBeforeMonth(m) + tm.Day - 1 - DAYS_1968_03_01_TO_1970;
+  if (days > DAYS_1970_TO_2100_03_01) days--; // 2100-02-29 does not exist
+  return days;
+}
+
 void breakTime(time_t timeInput, tmElements_t &tm) {
   // break the given time_t into time components
   // this is a more compact version of the C library localtime function
   // note that year is offset from 1970 !!!
 
-  uint16_t tmp_year = 0;
-  uint16_t yearLength = 0;
-  uint8_t tmp_month = 1;
-  uint8_t monthLength = 0;
   uint32_t tmp_time = (uint32_t)timeInput;
 
   tm.Second = tmp_time % 60;
@@ -171,21 +299,9 @@ void breakTime(time_t timeInput, tmElements_t &tm) {
   tmp_time /= 60; // now it is hours
   tm.Hour = tmp_time % 24;
   tmp_time /= 24; // now it is days
-  tm.Wday = ((tmp_time + 4) % 7) + 1;  // Sunday is day 1
-
-  while ((yearLength = getYearDays(tmp_year)) <= tmp_time) {
-    tmp_time -= yearLength;
-    tmp_year++;
-  }
-  tm.Year = tmp_year; // year is offset from 1970
+  tm.Wday = (((uint16_t)tmp_time + 4) % 7) + 1;  // Sunday is day 1
 
-  while ((monthLength = getMonthDays(tmp_year, tmp_month)) <= tmp_time) {
-      tmp_time -= monthLength;
-      tmp_month++;
-  }
-  tm.Month = tmp_month;  // jan is month 1
-
-  tm.Day = tmp_time + 1;     // day of month
+  civilFromDays(tmp_time, tm); // year is offset from 1970, jan is month 1
 }
 
 time_t makeTime(tmElements_t &tm) {
@@ -193,20 +309,9 @@ time_t makeTime(tmElements_t &tm) {
   // note year argument is offset from 1970 (see macros in time.h to convert to other formats)
   // previous version used full four digit year (or digits since 2000),i.e. 2009 was 2009 or 9
 
-  uint8_t i;
-  uint32_t seconds = 0;
-  uint16_t days = 0;
+  uint32_t seconds;
 
-  // seconds from 1970 till 1 jan 00:00:00 of the given year
-  for (i = 0; i < tm.Year; i++) {
-    days += getYearDays(i);
-  }
-
-  // add days for this year, months start from 1
-  for (i = 1; i < tm.Month; i++) {
-    days += getMonthDays(tm.Year, i);
-  }
-  seconds += (days + tm.Day - 1) * SECS_PER_DAY;
+  seconds = daysFromCivil(tm) * SECS_PER_DAY;
   seconds += tm.Hour * SECS_PER_HOUR;
   seconds += tm.Minute * SECS_PER_MIN;
   seconds += tm.Second;
@@ -216,80 +321,149 @@ time_t makeTime(tmElements_t &tm) {
 /*=====================================================*/
 /* Low level system time functions  */
 
-time_t now() {
-  while (wdt_microsecond - prev_microsecond >= 1000000UL) {
-    sysTime++;
-    prev_microsecond += 1000000UL;
+// microseconds in Q8.24 seconds, x * 2^24 / 10^6 = x * 2^18 / 15625, in two steps to stay in 32 bits
+static uint32_t microsecondToPhase(uint32_t microsecond) {
+  return ((microsecond / 15625) << 18) + (((microsecond % 15625) << 18) / 15625);
+}
+
+// seconds and phase, read together
+static uint32_t readTime(uint32_t &phase) {
+  uint32_t t;
+#if WDT_SLEEP_INTERVAL > WDT_INTERVAL
+  bool catch_up;
+  uint32_t tick;
+#endif
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { // also called with interrupts off, keep them off
+    t = sysTime;
+    phase = time_phase;
+#if WDT_SLEEP_INTERVAL > WDT_INTERVAL
+    catch_up = wdt_catch_up;
+    tick = wdt_active_phase << (wdt_interval - WDT_INTERVAL);
+#endif
   }
 
-  return (time_t)sysTime;
+#if WDT_SLEEP_INTERVAL > WDT_INTERVAL
+  if (catch_up) { // woken inside a long tick, count the awake time until it ends
+    uint32_t elapsed = (millis() - wake_millis) * (PHASE_SECOND / 1000);
+    if (elapsed >= tick) elapsed = tick - 1; // never run ahead of the tick
+    phase += elapsed;
+    t += phase >> 24;
+    phase &= PHASE_SECOND - 1;
+  }
+#endif
+  return t;
+}
+
+time_t now() {
+  uint32_t phase;
+  return (time_t)readTime(phase);
+}
+
+time_t nowPhase(uint16_t &phase) {
+  uint32_t p;
+  time_t t = (time_t)readTime(p);
+  phase = p >> 8;
+  return t;
 }
 
 void setTime(time_t t) {
-  sysTime = (uint32_t)t;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    sysTime = (uint32_t)t;
+    time_phase = 0; // restart counting from now (thanks to Korman for this fix)
+  }
   Status = timeSet;
-  prev_microsecond = wdt_microsecond; // restart counting from now (thanks to Korman for this fix)
 }
 
 void setTime(uint8_t hr, uint8_t mnt, uint8_t scnd, uint8_t dy, uint8_t mnth, uint16_t yr) {
   // year can be given as full four digit year or two digts (2010 or 10 for 2010);
   //it is converted to years since 1970
+  tmElements_t elements; // not the cache, it still describe cacheTime
   if ( yr > 99)
     yr = yr - 1970;
   else
     yr += 30;
-  tm.Year = yr;
-  tm.Month = mnth;
-  tm.Day = dy;
-  tm.Hour = hr;
-  tm.Minute = mnt;
-  tm.Second = scnd;
-  setTime(makeTime(tm));
+  elements.Year = yr;
+  elements.Month = mnth;
+  elements.Day = dy;
+  elements.Hour = hr;
+  elements.Minute = mnt;
+  elements.Second = scnd;
+  setTime(makeTime(elements));
 }
 
 void adjustTime(long adjustment) {
-  sysTime += adjustment;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    sysTime += adjustment;
+  }
 }
 
 /* WDT and power related */
-// TODO: dynamic calibrate wdt_microsecond_per_interrupt by current voltage (readVcc) and temperature
-uint32_t wdt_microsecond_per_interrupt = DEFAULT_WDT_MICROSECOND; // calibrate value
-uint32_t wdt_interrupt_count = 0;
-
 // 0=16ms, 1=32ms,2=64ms,3=128ms,4=250ms,5=500ms
 // 6=1 sec,7=2 sec, 8=4 sec, 9= 8sec
-void setup_watchdog(uint8_t ii) {
+// call with interrupts disabled, the change must complete within 4 cycles
+static void set_watchdog_prescaler(uint8_t ii) {
   byte bb;
-  int ww;
   if (ii > 9 ) ii = 9;
   bb = ii & 7;
   if (ii > 7) bb |= (1 << 5);
   bb |= (1 << WDCE);
-  ww = bb;
 
-  MCUSR &= ~(1 << WDRF);
+  wdt_reset(); // restart counting from this tick
   // start timed sequence
   WDTCR |= (1 << WDCE) | (1 << WDE);
   // set new watchdog timeout value
   WDTCR = bb;
   WDTCR |= _BV(WDIE);
+}
+
+void setup_watchdog(uint8_t ii) {
+  MCUSR &= ~(1 << WDRF);
+  cli();
+  set_watchdog_prescaler(ii);
+#if WDT_SLEEP_INTERVAL > WDT_INTERVAL
+  wdt_interval = wdt_next_interval = ii;
+#endif
   sbi(GIMSK, PCIE); // Turn on Pin Change interrupts (Tell Attiny85 we want to use pin change interrupts (can be any pin))
   sbi(PCMSK, PCINT3);
   //sbi(PCMSK, PCINT4);
   sei();    // Enable the Interrupts
 }
 
+// calibrate value the ISR adds per tick
+static void setActiveMicrosecond(uint32_t microsecond) {
+  uint32_t phase = microsecondToPhase(microsecond);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    wdt_active_microsecond = microsecond;
+    wdt_active_phase = phase;
+  }
+}
+
+// journal record of the time set and the calibrate value
+typedef struct {
+  uint32_t time; // sysTime, time_t is wider on non-AVR builds
+  uint32_t microsecond_per_interrupt;
+} time_record_t;
+
 void init_time() {
-  time_t t;
-  EEPROM.get(TIME_ADDR, t);
+  time_record_t record;
+#ifdef WATCH_JOURNAL
+  if (!journal_read(&record)) { // none yet, take the one older firmware kept at TIME_ADDR
+    EEPROM.get(TIME_ADDR, record);
+  }
+#else
+  EEPROM.get(TIME_ADDR, record);
+#endif
+  uint32_t t = record.time;
   if (t < 1451606400) t = 1451606400; // 2016-01-01
   setTime(t);
 
-  uint32_t temp_microsecond_per_interrupt;
-  EEPROM.get(TIME_ADDR + 4, temp_microsecond_per_interrupt);
-  if ((temp_microsecond_per_interrupt >= 950000UL) && (temp_microsecond_per_interrupt <= 1050000UL)) {
-    wdt_microsecond_per_interrupt = temp_microsecond_per_interrupt;
+  if ((record.microsecond_per_interrupt >= 950000UL) && (record.microsecond_per_interrupt <= 1050000UL)) {
+    wdt_microsecond_per_interrupt = record.microsecond_per_interrupt;
   }
+#ifdef WATCH_DRIFT_TABLE
+  EEPROM.get(DRIFT_ADDR, drift_table);
+#endif
+  setActiveMicrosecond(wdt_microsecond_per_interrupt); // with the drift table, until the first sensor values pick a bucket
 
   // init WDT
   setup_watchdog(WDT_INTERVAL);
@@ -299,63 +473,262 @@ void init_time() {
 ISR(WDT_vect) {
   sleep_disable();
 
-  wdt_interrupt_count++;
-  wdt_microsecond += wdt_microsecond_per_interrupt;
-  // flush microsecond every half an hour to avoid overflow
-  if (wdt_microsecond > 1800000000UL) {
-    now();
-    wdt_microsecond -= prev_microsecond;
-    prev_microsecond = 0;
+  // every prescaler divides the same oscillator, so the 1 second calibration
+  // scaled by the prescaler ratio is the calibration of the others
+#if WDT_SLEEP_INTERVAL > WDT_INTERVAL
+  uint8_t shift = wdt_interval - WDT_INTERVAL;
+#else
+  const uint8_t shift = 0;
+#endif
+  wdt_interrupt_count += 1 << shift; // in 1 second ticks, as wdt_auto_tune() expects
+  uptime_seconds += 1 << shift;
+  uint32_t phase = time_phase + (wdt_active_phase << shift); // below 256 seconds
+  uint32_t t = sysTime + (phase >> 24);
+  sysTime = t;
+  time_phase = phase & (PHASE_SECOND - 1);
+#ifdef WATCH_ALARMS
+  if (t >= deadline) deadline_flag = true; // the only alarm work of a tick, see Alarm.h
+#endif
+#if WDT_SLEEP_INTERVAL > WDT_INTERVAL
+  wdt_catch_up = false;
+  if (wdt_next_interval != wdt_interval) { // switch at a tick boundary, so every tick is whole
+    wdt_interval = wdt_next_interval;
+    set_watchdog_prescaler(wdt_interval);
   }
+#endif
 
   sleep_enable();
 }
 
+#ifdef WATCH_DRIFT_TABLE
+/* WDT drift table */
+static uint16_t readDrift(uint8_t bucket) {
+  return drift_table[bucket];
+}
+
+// calibrate value of a bucket, offset from DEFAULT_WDT_MICROSECOND is stored with a 0x8000 bias
+static uint32_t driftMicrosecond(uint8_t bucket) {
+  uint16_t value = readDrift(bucket);
+  if (value == DRIFT_UNSET) return wdt_microsecond_per_interrupt;
+  return DEFAULT_WDT_MICROSECOND + (int32_t)value - 0x8000;
+}
+
+// add the time since the last call to the current bucket
+static void countDrift() {
+  uint32_t units = (get_wdt_interrupt_count() - drift_since) / DRIFT_SLEEP_SAMPLE;
+  drift_since += units * DRIFT_SLEEP_SAMPLE;
+  if (drift_bucket < DRIFT_BUCKETS) {
+    while ((uint16_t)drift_time[drift_bucket] + units > 0xFF) { // keep the ratios, halve all
+      for (uint8_t i = 0; i < DRIFT_BUCKETS; i++) drift_time[i] >>= 1;
+      units >>= 1;
+    }
+    drift_time[drift_bucket] += units;
+  }
+}
+
+// bucket from the cached sensor values, every bucket but the last one is one step wide
+static uint8_t getDriftBucket() {
+  uint8_t t = 0;
+  int32_t temp = cachedTemp - DRIFT_TEMP_FIRST;
+  while ((temp >= 0) && (t < DRIFT_TEMP_BUCKETS - 1)) {
+    temp -= DRIFT_TEMP_STEP;
+    t++;
+  }
+  uint8_t v = 0;
+  int32_t vcc = cachedVcc - DRIFT_VCC_FIRST;
+  while ((vcc >= 0) && (v < DRIFT_VCC_BUCKETS - 1)) {
+    vcc -= DRIFT_VCC_STEP;
+    v++;
+  }
+  return (t * DRIFT_VCC_BUCKETS) + v;
+}
+
+// pick the calibrate value for the latest sensor values
+static void selectDrift() {
+  countDrift();
+  uint8_t bucket = getDriftBucket();
+  if (bucket != drift_bucket) {
+    setActiveMicrosecond(driftMicrosecond(bucket));
+    drift_bucket = bucket;
+  }
+}
+
+// the session measured an average microsecond per interrupt, correct the buckets it went
+// through in proportion to their share of it, so the table reproduces the measurement
+// (a Kaczmarz step, each session is one equation of the share weighted buckets)
+static void learnDrift(uint32_t measured) {
+  countDrift();
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < DRIFT_BUCKETS; i++) total += drift_time[i];
+  if (total == 0) return;
+
+  uint16_t share[DRIFT_BUCKETS]; // 256 = whole session
+  int32_t predicted = 0; // model average, offset from the old wdt_microsecond_per_interrupt
+  uint32_t norm = 0; // sum of share squares
+  for (uint8_t i = 0; i < DRIFT_BUCKETS; i++) {
+    share[i] = ((uint16_t)drift_time[i] << 8) / total;
+    predicted += share[i] * (int32_t)(driftMicrosecond(i) - wdt_microsecond_per_interrupt);
+    norm += (uint32_t)share[i] * share[i]; // a lone bucket gives 65536
+  }
+  if (norm == 0) return;
+  int32_t error = (int32_t)(measured - wdt_microsecond_per_interrupt) - (predicted >> 8);
+  int32_t gain = (1UL << 24) / norm; // 256 / sum of squared shares, 256 for a single bucket
+
+  for (uint8_t i = 0; i < DRIFT_BUCKETS; i++) {
+    if (share[i] == 0) continue;
+    int32_t offset = (int32_t)(driftMicrosecond(i) - DEFAULT_WDT_MICROSECOND) + ((((error * share[i]) >> 8) * gain) >> 8);
+    if ((offset < -0x8000) || (offset > 0x7FFE)) continue; // out of table range, leave it to the average
+    drift_table[i] = offset + 0x8000;
+  }
+  eeprom_write_async(DRIFT_ADDR, drift_table, sizeof(drift_table));
+}
+
+// count bucket time from now and reload the calibrate value
+static void startDriftSession() {
+  memset(drift_time, 0, sizeof(drift_time));
+  drift_since = get_wdt_interrupt_count();
+  drift_bucket = 0xFF;
+  selectDrift();
+}
+#endif
+
 void wdt_auto_tune() {
+  uint32_t t, count;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    t = sysTime; // and the ticks counted so far, from the same tick
+    count = wdt_interrupt_count;
+  }
   // skip tuning for the first input after power on
   if (prev_sysTime == 0) {
-        prev_sysTime = sysTime - (millis() / 1000); // init prev_sysTime
+        prev_sysTime = t - (millis() / 1000); // init prev_sysTime
+#ifdef WATCH_DRIFT_TABLE
+        startDriftSession();
+#endif
   } else {
     // check only tune the time if it have pass enough time range (> 1 hour)
-    if (wdt_interrupt_count > 3600) {
+    if (count > 3600) {
       // calculation equation: wdt_microsecond_per_interrupt = (sysTime - prev_sysTime) / wdt_interrupt_count * 1,000,000 micro second
       // rephase equation to use a maximum factor (3579) to retain significant value and avoid overflow
       // factor allow 20% adjustment: 2^32 / 1.2 / 1000000 = 3579
-      wdt_microsecond_per_interrupt = 3579 * 1000000 / wdt_interrupt_count * (sysTime - prev_sysTime) / 3579;
+      uint32_t measured = 3579UL * 1000000UL / count * (t - prev_sysTime) / 3579;
+#ifdef WATCH_DRIFT_TABLE
+      learnDrift(measured);
+      wdt_microsecond_per_interrupt = measured; // for buckets not learned yet
+#else
+      wdt_microsecond_per_interrupt = measured;
+      setActiveMicrosecond(measured);
+#endif
+
+      // Reset stat data after tune
+      ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        wdt_interrupt_count = 0;
+      }
+      prev_sysTime = t;
+#ifdef WATCH_DRIFT_TABLE
+      startDriftSession();
+#endif
+    }
+  }
+  time_record_t record = {t, wdt_microsecond_per_interrupt};
+#ifdef WATCH_JOURNAL
+  journal_append(&record); // written in background, to the next journal slot
+#else
+  eeprom_write_async(TIME_ADDR, &record, sizeof(record)); // written before it returns
+#endif
+}
 
-      // Reset time and stat data after tune
-      prev_microsecond = 0;
-      wdt_microsecond = 0;
-      wdt_interrupt_count = 0;
-      prev_sysTime = sysTime;
+// ask for a WDT interval, it takes effect at the end of the running tick
+void set_wdt_interval(uint8_t ii) {
+#if WDT_SLEEP_INTERVAL > WDT_INTERVAL
+  if (ii < WDT_INTERVAL) ii = WDT_INTERVAL; // timekeeping counts whole seconds
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    wdt_next_interval = ii;
+    if ((ii < wdt_interval) && !wdt_catch_up) { // woken by the button inside a long tick
+      wake_millis = millis();
+      wdt_catch_up = true;
     }
   }
-  EEPROM.put(TIME_ADDR, sysTime);
-  delay(5); // wait EEPROM write finish
-  EEPROM.put(TIME_ADDR + 4, wdt_microsecond_per_interrupt);
-  delay(5); // wait EEPROM write finish
+#else
+  (void)ii; // always WDT_INTERVAL
+#endif
 }
 
 // set system into the sleep state
 // system wakes up when watchdog is timed out
 void system_sleep() {
+  bool sampling = adc_busy();
+#ifdef WATCH_DRIFT_TABLE
+  if (!sampling && (get_wdt_interrupt_count() - drift_since >= DRIFT_SLEEP_SAMPLE)) { // keep the drift bucket current
+    adc_round_millis = millis() - ADC_SAMPLE_INTERVAL; // a round now
+    sampling = true;
+  }
+#endif
+  if (sampling) {
+    adc_service();
+    if (adc_busy()) { // by interrupt as when awake, idle through the settle waits and conversions
+      system_idle();
+      return;
+    }
+  }
+  adc_round_millis = millis() - ADC_SAMPLE_INTERVAL; // and sample again at once after wake up
   cbi(ADCSRA, ADEN);                   // switch Analog to Digital converter OFF
-  set_sleep_mode(SLEEP_MODE_PWR_DOWN); // sleep mode is set here
+  // sleep mode is set here, EEPROM ready cannot wake power down, idle till the journal is written
+  set_sleep_mode(eeprom_busy() ? SLEEP_MODE_IDLE : SLEEP_MODE_PWR_DOWN);
+#ifdef WATCH_ENERGY
+  uint32_t tick = uptime_seconds;
+  energy_sleep();
+#endif
   sleep_mode();                        // System actually sleeps here
+#ifdef WATCH_ENERGY
+  energy_wake(uptime_seconds != tick); // else woken by the button pin change
+#endif
   sbi(ADCSRA, ADEN);                   // switch Analog to Digital converter ON
 }
 
+// idle until the next interrupt, timers and ADC keep running
+void system_idle() {
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_mode();
+}
+
 uint32_t get_wdt_microsecond_per_interrupt() {
-  return wdt_microsecond_per_interrupt;
+  return wdt_active_microsecond;
 }
 uint32_t get_wdt_interrupt_count() {
-  return wdt_interrupt_count;
+  uint32_t count;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    count = wdt_interrupt_count;
+  }
+  return count;
+}
+uint32_t get_uptime() {
+  uint32_t seconds;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    seconds = uptime_seconds;
+  }
+  return seconds;
 }
 
+#ifdef WATCH_ALARMS
+void set_deadline(time_t t) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    deadline = (uint32_t)t;
+    deadline_flag = false;
+  }
+}
+
+bool deadline_reached() {
+  if (!deadline_flag) return false;
+  deadline_flag = false;
+  return true;
+}
+#endif
+
 
 // Voltage and Temperature related
 // Common code for both sources of an ADC conversion
 uint16_t readADC() {
+  ENERGY_COUNT(adc_conversions);
   ADCSRA |= _BV(ADSC); // Start conversion
   while (bit_is_set(ADCSRA, ADSC)); // measuring
   return ADC;
@@ -374,38 +747,181 @@ uint16_t getNewAccumulatedValue(uint16_t accumulatedValue, uint16_t value) {
 void readRawVcc() {
   // Read 1.1V reference against AVcc
   // set the reference to Vcc and the measurement to the internal 1.1V reference
-  ADMUX = _BV(MUX3) | _BV(MUX2);
-  delay(2); // Wait for Vref to settle
+  ADMUX = VCC_ADMUX;
+  delay(ADC_SETTLE_MS); // Wait for Vref to settle
 
   accumulatedRawVcc = getNewAccumulatedValue(accumulatedRawVcc, readADC());
 }
 
 uint32_t getVcc() {
-  readRawVcc();
-  return DEFAULT_VOLTAGE_REF / (accumulatedRawVcc >> 6); // calibrated value, average Vcc in millivolts
+  return cachedVcc; // average Vcc in millivolts, from the last sampling round
 }
 
 void readRawTemp() {
   // Measure temperature
-  ADMUX = 0xF | _BV( REFS1 ); // ADC4 (Temp Sensor) and Ref voltage = 1.1V;
-  delay(2); // Wait for Vref to settle
+  ADMUX = TEMP_ADMUX;
+  delay(ADC_SETTLE_MS); // Wait for Vref to settle
 
   accumulatedRawTemp = getNewAccumulatedValue(accumulatedRawTemp, readADC());
 }
 
 uint32_t getRawTemp() {
-  readRawTemp();
   return accumulatedRawTemp;
 }
 
 int32_t getTemp() {
-  readRawTemp();
+  return cachedTemp; // milli degree Celsius, from the last sampling round
+}
+
+int8_t getTempC() {
+  return milliToWhole(cachedTemp);
+}
 
+#ifdef WATCH_DIVISION_FREE
+/* Vcc = DEFAULT_VOLTAGE_REF / raw, from a table every 16 raw steps down to 256 (4.4 V),
+ * interpolated, then made exact with the remainder, which is a few raw steps at most
+ */
+#define VCC_TABLE_FIRST 256
+#define VCC_TABLE_SHIFT 4
+#define VCC_AT(raw) ((uint16_t)((DEFAULT_VOLTAGE_REF + ((raw) / 2)) / (raw)))
+#define VCC_ROW(raw) VCC_AT(raw), VCC_AT(raw + 16), VCC_AT(raw + 32), VCC_AT(raw + 48), \
+                     VCC_AT(raw + 64), VCC_AT(raw + 80), VCC_AT(raw + 96), VCC_AT(raw + 112)
+static const uint16_t vcc_table[] PROGMEM = {
+  VCC_ROW(256), VCC_ROW(384), VCC_ROW(512), VCC_ROW(640), VCC_ROW(768), VCC_ROW(896), VCC_AT(1024)
+};
+
+uint32_t convertVcc(uint16_t rawVcc) {
+  if (rawVcc < VCC_TABLE_FIRST) { // above 4.4 V, never from a coin cell
+    return DEFAULT_VOLTAGE_REF / (rawVcc ? rawVcc : 1);
+  }
+  uint8_t i = (rawVcc - VCC_TABLE_FIRST) >> VCC_TABLE_SHIFT;
+  uint8_t fraction = rawVcc & ((1 << VCC_TABLE_SHIFT) - 1);
+  uint16_t vcc = pgm_read_word(&vcc_table[i]);
+  uint16_t step = vcc - pgm_read_word(&vcc_table[i + 1]);
+  vcc -= (step * fraction) >> VCC_TABLE_SHIFT;
+
+  // floor, as the division: 0 <= DEFAULT_VOLTAGE_REF - vcc * raw < raw
+  int32_t remainder = DEFAULT_VOLTAGE_REF - ((uint32_t)vcc * rawVcc);
+  while (remainder < 0) {
+    vcc--;
+    remainder += rawVcc;
+  }
+  while (remainder >= rawVcc) {
+    vcc++;
+    remainder -= rawVcc;
+  }
+  return vcc;
+}
+#else
+uint32_t convertVcc(uint16_t rawVcc) {
+  return DEFAULT_VOLTAGE_REF / (rawVcc ? rawVcc : 1);
+}
+#endif
+
+int32_t convertTemp(uint16_t accumulatedRawTemp, uint32_t vcc) {
   // Temperature compensation using the chip voltage
   // with 3.0 V VCC is 1 lower than measured with 1.7 V VCC
-  uint32_t vcc = getVcc();
-  uint16_t compensation = (vcc < 1700) ? 0 : ( (vcc > 3000) ? 1000 : (vcc - 1700) * 10 / 13);
+  // (vcc - 1700) * 10 / 13, 50413 / 65536 = 10 / 13 within every step of the 1300 mV range
+  uint16_t compensation = (vcc < 1700) ? 0 : ((vcc > 3000) ? 1000 : (((vcc - 1700) * 50413UL) >> 16));
+
+  int32_t temp = ((int32_t)accumulatedRawTemp * TEMP_SCALE_WHOLE) - TEMP_OFFSET_WHOLE;
+  temp += (((uint32_t)accumulatedRawTemp * TEMP_SCALE_FRACTION) + TEMP_OFFSET_FRACTION) >> 16;
+  return temp + compensation;
+}
+
+// x / 1000 = (x / 8) / 125, 268436 / 2^25 is 1 / 125 a little over, exact for the truncation up to 127999
+int8_t milliToWhole(int32_t milli) {
+  if (milli > 127999) milli = 127999;
+  if (milli < -127999) milli = -127999;
+#ifdef WATCH_DIVISION_FREE
+  uint32_t magnitude = (milli < 0) ? -milli : milli;
+  int8_t whole = ((magnitude >> 3) * 268436UL) >> 25;
+  return (milli < 0) ? -whole : whole;
+#else
+  return milli / 1000;
+#endif
+}
+
+// turn the accumulated raw values into Vcc and temperature
+static void updateSensorValues() {
+  cachedVcc = convertVcc(accumulatedRawVcc >> 6); // calibrated value, average Vcc in millivolts
+  cachedTemp = convertTemp(accumulatedRawTemp, cachedVcc);
+
+#ifdef WATCH_DRIFT_TABLE
+  selectDrift();
+#endif
+}
+
+// first sampling round, blocking, so getVcc() and getTemp() have values from the start
+void init_adc() {
+  readRawVcc();
+  readRawTemp();
+  updateSensorValues();
+  adc_round_millis = millis();
+}
+
+#ifdef WATCH_ADC_INTERRUPT
+// ADC conversion complete interrupt, only the sampling rounds enable it
+ISR(ADC_vect) {
+  cbi(ADCSRA, ADIE);
+  ENERGY_COUNT(adc_conversions);
+  if (adc_state == adc_convert_vcc) {
+    accumulatedRawVcc = getNewAccumulatedValue(accumulatedRawVcc, ADC);
+    ADMUX = TEMP_ADMUX; // temperature next, after the reference settles
+    adc_settle_millis = millis();
+    adc_state = adc_settle_temp;
+  } else if (adc_state == adc_convert_temp) {
+    accumulatedRawTemp = getNewAccumulatedValue(accumulatedRawTemp, ADC);
+    adc_state = adc_ready;
+  }
+}
+
+// sampling round every ADC_SAMPLE_INTERVAL, Vcc then temperature, call it from loop()
+// never waits, returns true when a round finished and new values are ready
+bool adc_service() {
+  switch (adc_state) {
+    case adc_idle:
+      if (millis() - adc_round_millis >= ADC_SAMPLE_INTERVAL) {
+        adc_round_millis = millis();
+        ADMUX = VCC_ADMUX;
+        adc_settle_millis = millis();
+        adc_state = adc_settle_vcc;
+      }
+      break;
+    case adc_settle_vcc:
+    case adc_settle_temp:
+      if (millis() - adc_settle_millis >= ADC_SETTLE_MS) {
+        adc_state = (adc_state == adc_settle_vcc) ? adc_convert_vcc : adc_convert_temp;
+        ADCSRA |= _BV(ADSC) | _BV(ADIE); // also clear a pending ADIF left by analogRead()
+      }
+      break;
+    case adc_ready:
+      updateSensorValues();
+      adc_state = adc_idle;
+      return true;
+    default: // converting
+      break;
+  }
+  return false;
+}
+
+// a sampling round owns ADMUX, analogRead() must wait
+bool adc_busy() {
+  return adc_state != adc_idle;
+}
+#else // WATCH_ADC_INTERRUPT
+// sampling round every ADC_SAMPLE_INTERVAL, read at once, call it from loop()
+// returns true when new values are ready
+bool adc_service() {
+  if (millis() - adc_round_millis < ADC_SAMPLE_INTERVAL) return false;
+  adc_round_millis = millis();
+  readRawVcc();
+  readRawTemp();
+  updateSensorValues();
+  return true;
+}
 
-  return (((accumulatedRawTemp * 100000L) - CHIP_TEMP_OFFSET) / CHIP_TEMP_COEFF) + compensation;
+bool adc_busy() {
+  return false;
 }
-
+#endif // WATCH_ADC_INTERRUPT
@@ -8,9 +8,46 @@
  * Internal temperature sensor: http://21stdigitalhome.blogspot.hk/2014/10/trinket-attiny85-internal-temperature.html
 */
 
-#define TIME_ADDR 0 // EEPROM address for storing the time you set, it can help restore the time easier after change the battery
+#define TIME_ADDR 0 // EEPROM address of the time record, without the journal (EEPROM_Journal.h) or while it is empty
 #define WDT_INTERVAL 6 // ~1 second
+/* tick while the display is off, 6 (default) keeps 1 second. 9 (~8 seconds) wakes
+ * 8 times less, but only for a ladder where every button raises a pin change
+ * (see Button.h): with the stock one down, and up on some chips, is only seen at
+ * the next tick, a press has to be held over it. The long tick is only built in
+ * when it is longer than WDT_INTERVAL.
+ */
+#ifndef WDT_SLEEP_INTERVAL
+#define WDT_SLEEP_INTERVAL 6
+#endif
 #define DEFAULT_WDT_MICROSECOND 1000000UL // put your calibrated value here, should be within +/- 10000 of 1000000 microseconds
+/* the time elements cache steps from the time it holds by the seconds since,
+ * about 150 bytes of flash, so only by define WATCH_CACHE_STEP; without it
+ * every new second is broken again by breakTime(), in constant time too.
+ */
+//#define WATCH_CACHE_STEP
+/* WDT drift table, the watchdog oscillator runs at a different rate for each
+ * temperature and Vcc, wdt_auto_tune() learns one calibrate value per bucket.
+ * About 1 KB of flash, so only by define WATCH_DRIFT_TABLE; without it one
+ * calibrate value is learned for all conditions.
+ */
+//#define WATCH_DRIFT_TABLE
+#define DRIFT_ADDR (TIME_ADDR + 8) // EEPROM address of the table, 2 bytes per bucket
+#define DRIFT_TEMP_BUCKETS 4 // below 15, 15 - 25, 25 - 35 and above 35 degree C
+#define DRIFT_TEMP_FIRST 15000L
+#define DRIFT_TEMP_STEP 10000L
+#define DRIFT_VCC_BUCKETS 2 // below and above 2.8 V
+#define DRIFT_VCC_FIRST 2800L
+#define DRIFT_VCC_STEP 300L
+#define DRIFT_SLEEP_SAMPLE 64 // seconds between sensor readings while sleeping, and the unit of bucket time
+#ifndef ADC_SAMPLE_INTERVAL
+#define ADC_SAMPLE_INTERVAL 1000 // milliseconds between Vcc and temperature samples while awake
+#endif
+/* a sampling round waits for the reference to settle and for the conversions
+ * by the ADC interrupt, so loop() never waits. That is about 700 bytes of
+ * flash, so only by define WATCH_ADC_INTERRUPT; without it a round is read at
+ * once, in about 4 ms.
+ */
+//#define WATCH_ADC_INTERRUPT
 
 /* calibrate voltage reference
  *  step 1: comment the follow 2 #define lines
@@ -22,7 +59,7 @@
 #define DEBUG_SCREEN_V 4979 // put your screen reading here
 #define MULTI_METER_VOLTAGE 4740 // put your multimeter reading here (in millivolt)
 #ifdef DEBUG_SCREEN_VOLTAGE // use calibrated value
-  #define 1125300UL / DEBUG_SCREEN_V * MULTI_METER_VOLTAGE
+  #define DEFAULT_VOLTAGE_REF (1125300UL / DEBUG_SCREEN_V * MULTI_METER_VOLTAGE)
 #else // use default value
   #define DEFAULT_VOLTAGE_REF 1125300UL // 1.1 * 1023 * 1000
 #endif
@@ -37,7 +74,7 @@
 #define TEMPERATURE_2     22500L
 #ifdef DEBUG_SCREEN_T_1 // use calibrated value
   #define CHIP_TEMP_COEFF ((DEBUG_SCREEN_T_1 - DEBUG_SCREEN_T_2) * 100000L / (TEMPERATURE_1 - TEMPERATURE_2))
-  #define CHIP_TEMP_OFFSET ((DEBUG_SCREEN_T_1 * 100000L) - (TEMPERATURE_1 * CHIP_TEMP_COEFF))
+  #define CHIP_TEMP_OFFSET ((DEBUG_SCREEN_T_1 * 100000LL) - (TEMPERATURE_1 * CHIP_TEMP_COEFF)) // over 32 bits, only used at compile time
 #else // use default value
   #define CHIP_TEMP_COEFF 6880L // 64 raw samples, 1.075 * 64 * 10000
   #define CHIP_TEMP_OFFSET 1746560000L // 64 raw samples, 272.9 *64 * 10000
@@ -45,6 +82,22 @@
 // Calibration of the temperature sensor has to be changed for your own ATtiny85
 // per tech note: http://www.atmel.com/Images/doc8108.pdf
 
+/* the calibration as multiply and shift, computed by the compiler, the ATtiny85 has no divider
+ * temperature = (accumulated * 100000 - CHIP_TEMP_OFFSET) / CHIP_TEMP_COEFF, in 1/65536 milli degree
+ *             = accumulated * TEMP_SCALE - TEMP_OFFSET, each split into whole and fraction parts
+ */
+#define TEMP_SCALE (((100000ULL << 16) + (CHIP_TEMP_COEFF / 2)) / CHIP_TEMP_COEFF)
+#define TEMP_SCALE_WHOLE ((uint16_t)(TEMP_SCALE >> 16))
+#define TEMP_SCALE_FRACTION ((uint16_t)(TEMP_SCALE & 0xFFFF))
+#define TEMP_OFFSET ((((long long)CHIP_TEMP_OFFSET << 16) + (CHIP_TEMP_COEFF / 2)) / CHIP_TEMP_COEFF)
+#define TEMP_OFFSET_WHOLE ((int32_t)((TEMP_OFFSET + 0xFFFF) >> 16)) // rounded up, the fraction is added back
+#define TEMP_OFFSET_FRACTION ((uint16_t)(((long long)TEMP_OFFSET_WHOLE << 16) - TEMP_OFFSET))
+/* Vcc from a PROGMEM table and whole degrees by a reciprocal, instead of the
+ * library division of a round (~600 cycles). That is about 350 bytes of
+ * flash, so only by define WATCH_DIVISION_FREE.
+ */
+//#define WATCH_DIVISION_FREE
+
 #ifndef _Time_h
 #ifdef __cplusplus
 #define _Time_h
@@ -162,6 +215,8 @@ extern "C++" {
   uint8_t getMonthDays(uint16_t y, uint8_t m);
 
   time_t  now();              // return the current time as seconds since Jan 1 1970
+  time_t  nowElements(tmElements_t &tm); // now() and all its elements from the same second
+  time_t  nowPhase(uint16_t &phase); // now() and how far into that second, in 1/65536 seconds
   void    setTime(time_t t);
   void    setTime(uint8_t hr, uint8_t min, uint8_t sec, uint8_t day, uint8_t month, uint16_t yr);
   void    adjustTime(long adjustment);
@@ -186,16 +241,28 @@ void init_time();
 /* WDT and power related */
 void wdt_setup();
 void wdt_auto_tune();
+void set_wdt_interval(uint8_t ii); // applied at the next WDT interrupt
 void system_sleep();
+void system_idle();
 uint32_t get_wdt_microsecond_per_interrupt(); // debug use only
 uint32_t get_wdt_interrupt_count(); // debug use only
+uint32_t get_uptime(); // seconds since power on, by WDT ticks
+// alarms, with WATCH_ALARMS (Alarm.h)
+void set_deadline(time_t t); // ISR(WDT_vect) flags the first tick at or after t, one compare per tick
+bool deadline_reached(); // flagged since the last call
 
 // Voltage and Temperature related
-static uint16_t accumulatedRawVcc = 0;
-static uint16_t accumulatedRawTemp = 0;
+void init_adc();
+bool adc_service(); // call from loop(), true when new values are ready
+bool adc_busy(); // a sampling round is using the ADC
 void readRawVcc(); // debug use only
 uint32_t getVcc();
 void readRawTemp(); // debug use only
 uint32_t getRawTemp();
 int32_t getTemp();
+int8_t getTempC(); // whole degree Celsius
+// conversions of the raw readings, Vcc and whole degrees without division by WATCH_DIVISION_FREE
+uint32_t convertVcc(uint16_t rawVcc); // millivolts
+int32_t convertTemp(uint16_t accumulatedRawTemp, uint32_t vcc); // milli degree Celsius
+int8_t milliToWhole(int32_t milli); // truncated toward zero, within +/- 127
 
@@ -0,0 +1,58 @@
+/*
+ * Stand-in for the Arduino core subset used by the watch firmware
+ * Host builds get the AVR headers from mcu/, avr-g++ builds (firmware_bench
+ * under simavr) use the real avr-libc ones with avr_runtime.cpp.
+ */
+#ifndef _host_Arduino_h
+#define _host_Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#ifndef __AVR__
+#include "host.h"
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define LOW 0x0
+#define HIGH 0x1
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+  public:
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str) { return (str) ? write((const uint8_t *)str, strlen(str)) : 0; }
+    virtual void flush() {}
+
+    size_t print(const char str[]) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n, int base = DEC) { return print((long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+
+  private:
+    size_t printNumber(unsigned long n, uint8_t base);
+};
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * Stand-in for the Arduino EEPROM library, 512 bytes like the ATtiny85
+ * Every byte actually written is counted in host_eeprom_writes, and per cell
+ * in host_eeprom_cell_writes on the host build.
+ */
+#ifndef _host_EEPROM_h
+#define _host_EEPROM_h
+
+#include <stdint.h>
+
+#define HOST_EEPROM_SIZE 512
+
+extern uint32_t host_eeprom_writes;
+
+#ifdef __AVR__
+#include <avr/eeprom.h>
+#define host_eeprom_read(idx) eeprom_read_byte((uint8_t *)(idx))
+#define host_eeprom_write(idx, val) eeprom_write_byte((uint8_t *)(idx), (val))
+#else
+extern uint8_t host_eeprom[HOST_EEPROM_SIZE];
+extern uint32_t host_eeprom_cell_writes[HOST_EEPROM_SIZE]; // wear of each cell
+#define host_eeprom_read(idx) host_eeprom[(idx) % HOST_EEPROM_SIZE]
+#define host_eeprom_write(idx, val) (host_eeprom_cell_writes[(idx) % HOST_EEPROM_SIZE]++, host_eeprom[(idx) % HOST_EEPROM_SIZE] = (val))
+#endif
+
+class EEPROMClass {
+  public:
+    uint8_t read(int idx) { return host_eeprom_read(idx); }
+    void write(int idx, uint8_t val) { host_eeprom_write(idx, val); host_eeprom_writes++; }
+    void update(int idx, uint8_t val) { if (read(idx) != val) write(idx, val); }
+    uint16_t length() { return HOST_EEPROM_SIZE; }
+
+    template <typename T> T &get(int idx, T &t) {
+      uint8_t *ptr = (uint8_t *)&t;
+      for (unsigned int i = 0; i < sizeof(T); i++) ptr[i] = read(idx + i);
+      return t;
+    }
+
+    template <typename T> const T &put(int idx, const T &t) {
+      const uint8_t *ptr = (const uint8_t *)&t;
+      for (unsigned int i = 0; i < sizeof(T); i++) update(idx + i, ptr[i]);
+      return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Stand-in for TinyWireM (USI I2C master)
+ * Keep the 18 bytes transmit buffer of the real library, so the driver split
+ * transactions the same way; each finished transaction goes to host_i2c_bus
+ * (none on avr-g++ builds, the bytes are dropped).
+ */
+#ifndef _host_TinyWireM_h
+#define _host_TinyWireM_h
+
+#include <Arduino.h>
+
+#define USI_BUF_SIZE 18
+
+// receiver of the finished write transactions, e.g. SSD1306Emulator
+class HostI2CDevice {
+  public:
+    virtual void transaction(uint8_t addr, const uint8_t *data, uint16_t len) = 0;
+};
+
+extern HostI2CDevice *host_i2c_bus;
+
+class USI_TWI {
+  public:
+    void begin() {}
+    void beginTransmission(uint8_t slave_addr);
+    size_t write(uint8_t data);
+    size_t send(uint8_t data) { return write(data); }
+    uint8_t endTransmission();
+    uint8_t endTransmission(uint8_t) { return endTransmission(); }
+
+  private:
+    uint8_t addr;
+    uint8_t buf[USI_BUF_SIZE];
+    uint8_t len;
+};
+
+extern USI_TWI TinyWireM;
+
+#endif
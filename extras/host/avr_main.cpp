@@ -0,0 +1,14 @@
+/*
+ * main() of the Arduino core, for the avr-g++ build of the watch firmware (make avr-size)
+ */
+#include <Arduino.h>
+#include "avr_runtime.h"
+
+void setup(void);
+void loop(void);
+
+int main(void) {
+  avr_runtime_init();
+  setup();
+  for (;;) loop();
+}
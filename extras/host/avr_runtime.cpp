@@ -0,0 +1,78 @@
+/*
+ * Minimal Arduino core for avr-g++ builds of the host tools (firmware_bench under simavr)
+ * Timer1 runs at CPU clock and counts cycles, millis() and delay() derive from it.
+ */
+#ifdef __AVR__
+#include <Arduino.h>
+#include <util/delay.h>
+#include "avr_runtime.h"
+
+static volatile uint32_t timer1_overflows = 0;
+
+extern "C" void __cxa_pure_virtual(void) {
+  while (1);
+}
+
+ISR(TIMER1_OVF_vect) {
+  timer1_overflows++;
+}
+
+void avr_runtime_init(void) {
+  TCCR1 = _BV(CS10); // Timer1 at CPU clock, no prescaler
+  TIMSK |= _BV(TOIE1);
+  TCCR0B = _BV(CS01) | _BV(CS00); // Timer0 at CK/64 as the Arduino core runs it, the display pump takes its compare B
+  ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1); // ADC on, clock / 64
+  sei();
+}
+
+uint32_t avr_cycles(void) {
+  uint8_t sreg = SREG;
+  cli();
+  uint8_t count = TCNT1;
+  uint32_t overflows = timer1_overflows;
+  if ((TIFR & _BV(TOV1)) && (count < 0x80)) overflows++; // overflow not served yet
+  SREG = sreg;
+  return (overflows << 8) | count;
+}
+
+// out of line as in the Arduino core, the firmware calls it from many places
+// and a link time optimizer would copy the cycle count and division into each
+__attribute__((noinline)) unsigned long millis(void) {
+  return avr_cycles() / (F_CPU / 1000UL);
+}
+
+unsigned long micros(void) {
+  return avr_cycles() / (F_CPU / 1000000UL);
+}
+
+void delay(unsigned long ms) {
+  while (ms--) _delay_ms(1);
+}
+
+void delayMicroseconds(unsigned int us) {
+  while (us--) _delay_us(1);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == OUTPUT) {
+    DDRB |= _BV(pin);
+  } else {
+    DDRB &= ~_BV(pin);
+    if (mode == INPUT_PULLUP) PORTB |= _BV(pin);
+    else PORTB &= ~_BV(pin);
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return (PINB & _BV(pin)) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  // ATtiny85 PB3 is ADC3, PB4 is ADC2, PB2 is ADC1, PB5 is ADC0
+  static const uint8_t channel[] = {0, 0, 1, 3, 2, 0};
+  ADMUX = channel[pin % 6]; // Vcc as reference
+  ADCSRA |= _BV(ADSC);
+  while (bit_is_set(ADCSRA, ADSC));
+  return ADC;
+}
+#endif
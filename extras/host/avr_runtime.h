@@ -0,0 +1,12 @@
+/*
+ * Minimal Arduino core for avr-g++ builds of the host tools
+ */
+#ifndef _avr_runtime_h
+#define _avr_runtime_h
+
+#include <stdint.h>
+
+void avr_runtime_init(void);
+uint32_t avr_cycles(void); // CPU cycles since avr_runtime_init()
+
+#endif
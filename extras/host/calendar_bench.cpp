@@ -0,0 +1,172 @@
+/*
+ * Compare breakTime() / makeTime() against the previous year-by-year walk:
+ * check both give the same result for every day from 1970 to 2106,
+ * check the time elements cache stepping across every midnight (built with WATCH_CACHE_STEP),
+ * then time them on the host.
+ *
+ * usage: calendar_bench [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "WDT_Time.h"
+
+/*
+ * previous implementation, walking years and months from 1970, as it was in
+ * WDT_Time.h / WDT_Time.cpp: the leap year rule and the month table are its own
+ */
+static  const uint8_t legacyMonthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}; // API starts months from 1, this array starts from 0
+
+static bool legacyLeapYear(uint16_t y) {
+  return !((1970 + y) % 4) && ( ((1970 + y) % 100) || !((1970 + y) % 400) );
+}
+
+static uint8_t legacyMonthLength(uint16_t y, uint8_t m) {
+  return ((m == 2) && legacyLeapYear(y)) ? 29 : legacyMonthDays[m - 1];
+}
+
+static uint16_t legacyYearDays(uint16_t y) {
+  return legacyLeapYear(y) ? 366 : 365;
+}
+
+static void legacyBreakTime(time_t timeInput, tmElements_t &tm) {
+  // break the given time_t into time components
+  // this is a more compact version of the C library localtime function
+  // note that year is offset from 1970 !!!
+
+  uint16_t tmp_year = 0;
+  uint16_t yearLength = 0;
+  uint8_t tmp_month = 1;
+  uint8_t monthLength = 0;
+  uint32_t tmp_time = (uint32_t)timeInput;
+
+  tm.Second = tmp_time % 60;
+  tmp_time /= 60; // now it is minutes
+  tm.Minute = tmp_time % 60;
+  tmp_time /= 60; // now it is hours
+  tm.Hour = tmp_time % 24;
+  tmp_time /= 24; // now it is days
+  tm.Wday = ((tmp_time + 4) % 7) + 1;  // Sunday is day 1
+
+  while ((yearLength = legacyYearDays(tmp_year)) <= tmp_time) {
+    tmp_time -= yearLength;
+    tmp_year++;
+  }
+  tm.Year = tmp_year; // year is offset from 1970
+
+  while ((monthLength = legacyMonthLength(tmp_year, tmp_month)) <= tmp_time) {
+      tmp_time -= monthLength;
+      tmp_month++;
+  }
+  tm.Month = tmp_month;  // jan is month 1
+
+  tm.Day = tmp_time + 1;     // day of month
+}
+
+static time_t legacyMakeTime(tmElements_t &tm) {
+  // assemble time elements into time_t
+  // note year argument is offset from 1970 (see macros in time.h to convert to other formats)
+  // previous version used full four digit year (or digits since 2000),i.e. 2009 was 2009 or 9
+
+  uint8_t i;
+  uint32_t seconds = 0;
+  uint16_t days = 0;
+
+  // seconds from 1970 till 1 jan 00:00:00 of the given year
+  for (i = 0; i < tm.Year; i++) {
+    days += legacyYearDays(i);
+  }
+
+  // add days for this year, months start from 1
+  for (i = 1; i < tm.Month; i++) {
+    days += legacyMonthLength(tm.Year, i);
+  }
+  seconds += (days + tm.Day - 1) * SECS_PER_DAY;
+  seconds += tm.Hour * SECS_PER_HOUR;
+  seconds += tm.Minute * SECS_PER_MIN;
+  seconds += tm.Second;
+  return (time_t)seconds;
+}
+
+static bool same(const tmElements_t &a, const tmElements_t &b) {
+  return (a.Second == b.Second) && (a.Minute == b.Minute) && (a.Hour == b.Hour) && (a.Wday == b.Wday)
+         && (a.Day == b.Day) && (a.Month == b.Month) && (a.Year == b.Year);
+}
+
+#define LAST_DAY 49710 // 2106-02-07, last day in 32 bits time_t
+
+static uint32_t sample_time(uint32_t day) {
+  uint32_t t = (day * SECS_PER_DAY) + ((day * 7919UL) % SECS_PER_DAY); // spread over the day
+  return (day == LAST_DAY) ? 0xFFFFFFFFUL : t;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 10) : 20;
+  tmElements_t a, b;
+
+  // every day of the time_t range must match
+  for (uint32_t day = 0; day <= LAST_DAY; day++) {
+    uint32_t t = sample_time(day);
+    legacyBreakTime(t, a);
+    breakTime(t, b);
+    if (!same(a, b)) {
+      printf("breakTime mismatch at %lu: %u-%u-%u, expected %u-%u-%u\n", (unsigned long)t,
+             tmYearToCalendar(b.Year), b.Month, b.Day, tmYearToCalendar(a.Year), a.Month, a.Day);
+      return 1;
+    }
+    if ((uint32_t)makeTime(b) != (uint32_t)legacyMakeTime(a) || ((uint32_t)makeTime(b) != t)) {
+      printf("makeTime mismatch at %lu: %lu, expected %lu\n", (unsigned long)t,
+             (unsigned long)(uint32_t)makeTime(b), (unsigned long)(uint32_t)legacyMakeTime(a));
+      return 1;
+    }
+  }
+  printf("checked %u days, 1970-01-01 to 2106-02-07\n", LAST_DAY + 1);
+
+  // the cache moves forward by small steps, stepping across each midnight must match breakTime()
+  for (uint32_t d = 1; d <= LAST_DAY; d++) {
+    uint32_t t = (d * SECS_PER_DAY) - 100;
+    second(t - 1000); // large jump, full conversion
+    for (uint8_t step = 1; t < (d * SECS_PER_DAY) + 100; t += step, step = (step % 59) + 1) {
+      breakTime(t, a);
+      if ((second(t) != a.Second) || (minute(t) != a.Minute) || (hour(t) != a.Hour) || (weekday(t) != a.Wday)
+          || (day(t) != a.Day) || (month(t) != a.Month) || (year(t) != tmYearToCalendar(a.Year))) {
+        printf("time elements cache mismatch at %lu\n", (unsigned long)t);
+        return 1;
+      }
+    }
+  }
+  printf("checked time elements cache across %u midnights\n", LAST_DAY);
+
+  // timing, sum results so the work cannot be optimized away
+  typedef std::chrono::steady_clock clock;
+  volatile uint32_t sink = 0;
+  double ns[6];
+  for (uint8_t impl = 0; impl < 6; impl++) {
+    clock::time_point start = clock::now();
+    for (uint32_t r = 0; r < rounds; r++) {
+      for (uint32_t day = 0; day <= LAST_DAY; day++) {
+        uint32_t t = sample_time(day);
+        switch (impl) {
+          case 0: legacyBreakTime(t, a); sink += a.Day; break;
+          case 1: breakTime(t, a); sink += a.Day; break;
+          case 2: breakTime(t, a); sink += legacyMakeTime(a); break;
+          case 3: breakTime(t, a); sink += makeTime(a); break;
+          // consecutive seconds, as the watch reads the time
+          case 4: breakTime(SECS_YR_2000 + (r * (LAST_DAY + 1)) + day, a); sink += a.Day; break;
+          case 5: sink += second(SECS_YR_2000 + (r * (LAST_DAY + 1)) + day); break;
+        }
+      }
+    }
+    ns[impl] = std::chrono::duration<double, std::nano>(clock::now() - start).count() / ((double)rounds * (LAST_DAY + 1));
+  }
+  // makeTime cost excludes the breakTime used to feed it
+  printf("function,implementation,ns_per_call\n");
+  printf("breakTime,legacy,%.1f\n", ns[0]);
+  printf("breakTime,constant,%.1f\n", ns[1]);
+  printf("makeTime,legacy,%.1f\n", ns[2] - ns[1]);
+  printf("makeTime,constant,%.1f\n", ns[3] - ns[1]);
+  printf("refreshCache,full,%.1f\n", ns[4]);
+  printf("refreshCache,incremental,%.1f\n", ns[5]);
+  return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * Arduino core, EEPROM and TinyWireM stand-in parts shared by host and avr-g++ builds
+ */
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <TinyWireM.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++)) n++;
+    else break;
+  }
+  return n;
+}
+
+size_t Print::print(long n, int base) {
+  if ((base == DEC) && (n < 0)) {
+    size_t t = print('-');
+    return printNumber(-n, base) + t;
+  }
+  return printNumber(n, base);
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+
+  return write(str);
+}
+
+uint32_t host_eeprom_writes = 0;
+EEPROMClass EEPROM;
+
+/*
+ * TinyWireM
+ */
+HostI2CDevice *host_i2c_bus = 0;
+USI_TWI TinyWireM;
+
+void USI_TWI::beginTransmission(uint8_t slave_addr) {
+  addr = slave_addr;
+  len = 0;
+}
+
+size_t USI_TWI::write(uint8_t data) {
+  if (len >= USI_BUF_SIZE) return 0; // buffer used up, same as the real library
+  buf[len++] = data;
+  return 1;
+}
+
+uint8_t USI_TWI::endTransmission() {
+  if (host_i2c_bus) host_i2c_bus->transaction(addr, buf, len);
+  len = 0;
+  return 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * Cost of the firmware hot paths, printed as CSV:
+ *   target,f_cpu,function,iterations,unit,per_call
+ *
+ * Host build: x86 TSC ticks (ns elsewhere), for quick relative numbers.
+ * avr-g++ build run under simavr ("make avr-bench"): ATtiny85 CPU cycles.
+ * I2C bus clocking is not included: the display bytes go to the null bus in
+ * null_i2c.cpp, both builds; oled_bench reports the bus time of a frame.
+ */
+#include "ATtinyWatch.cpp" // generated from ATtinyWatch.ino by the Makefile
+#include "bench_fonts.h" // digit fonts plain and run length coded, generated by the Makefile
+#include "font_rle.h"
+
+#ifdef __AVR__
+#include "avr_runtime.h"
+#include <simavr/avr/avr_mcu_section.h>
+AVR_MCU(F_CPU, "attiny85");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0); // simavr prints what is written here
+
+#define BENCH_TARGET "attiny85"
+#define BENCH_F_CPU F_CPU
+#define BENCH_UNIT "cycles"
+#define BENCH_ITERATIONS 16
+typedef uint32_t bench_ticks_t;
+static bench_ticks_t bench_ticks(void) { return avr_cycles(); }
+static void bench_putc(char c) { GPIOR0 = c; }
+
+#else // host
+#include <stdio.h>
+#define BENCH_TARGET "host"
+#define BENCH_F_CPU 0
+#define BENCH_ITERATIONS 10000
+typedef uint64_t bench_ticks_t;
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "tsc"
+static bench_ticks_t bench_ticks(void) { return __rdtsc(); }
+#else
+#include <chrono>
+#define BENCH_UNIT "ns"
+static bench_ticks_t bench_ticks(void) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+static void bench_putc(char c) { putchar(c); }
+#endif
+
+static volatile uint32_t bench_sink; // keep results alive
+
+static void bench_print(const char *str) {
+  while (*str) bench_putc(*str++);
+}
+
+static void bench_print_P(const char *str) {
+  char c;
+  while ((c = pgm_read_byte(str++))) bench_putc(c);
+}
+
+static void bench_print_number(uint32_t n) {
+  char buf[11];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  do {
+    *--str = '0' + (n % 10);
+    n /= 10;
+  } while (n);
+  bench_print(str);
+}
+
+/*
+ * benchmarked functions, i is the iteration number
+ */
+static void bench_empty(uint16_t) {}
+
+static void bench_breakTime(uint16_t i) {
+  tmElements_t elements;
+  breakTime(SECS_YR_2000 + (i * 86413UL), elements);
+  bench_sink += elements.Day;
+}
+
+static void bench_makeTime(uint16_t i) {
+  tmElements_t elements = {56, 34, 12, 0, 1, 10, CalendarYrToTm(2026)};
+  elements.Day = 1 + (i % 28);
+  bench_sink += makeTime(elements);
+}
+
+static void bench_now(uint16_t) {
+  bench_sink += now();
+}
+
+static void bench_getTemp(uint16_t) {
+  bench_sink += getTemp();
+}
+
+static void bench_getVcc(uint16_t) {
+  bench_sink += getVcc();
+}
+
+// Vcc and temperature readings from 2.0 to 3.4 V, 15 to 40 C
+static void bench_convertVcc(uint16_t i) {
+  bench_sink += convertVcc(330 + (i % 230));
+}
+
+static void bench_convertVcc_divide(uint16_t i) {
+  bench_sink += DEFAULT_VOLTAGE_REF / (330 + (i % 230));
+}
+
+static void bench_convertTemp(uint16_t i) {
+  bench_sink += convertTemp(19000 + (i % 4000), 2000 + (i % 1400));
+}
+
+static void bench_convertTemp_divide(uint16_t i) {
+  uint16_t vcc = 2000 + (i % 1400);
+  uint16_t compensation = (vcc > 3000) ? 1000 : (vcc - 1700) * 10 / 13;
+  bench_sink += ((((19000 + (i % 4000)) * 100000L) - (long)CHIP_TEMP_OFFSET) / CHIP_TEMP_COEFF) + compensation; // 32 bits as before
+}
+
+static void bench_write(uint16_t i) {
+  oled.set_font_size(2);
+  oled.set_pos(0, 2);
+  oled.write('0' + (i % 10)); // new digit every time, no cell cache hit
+  oled.flush();
+}
+
+// glyph decode only, into a sink instead of the I2C buffer
+static volatile uint8_t glyph_sink;
+
+static void bench_glyph_2x_plain(uint16_t i) {
+  uint16_t offset = (i % 10) * (2 * PLAIN_2X_WIDTH);
+  for (uint8_t j = 0; j < 2 * PLAIN_2X_WIDTH; j++) glyph_sink = pgm_read_byte_near(&plain_2x_bitmap[offset++]);
+}
+
+static void bench_glyph_2x_rle(uint16_t i) {
+  rle_glyph_t rle;
+  rle_glyph_start(rle, rle_2x_bitmap, i % 10);
+  for (uint8_t j = 0; j < 2 * RLE_2X_WIDTH; j++) glyph_sink = rle_glyph_next(rle);
+}
+
+static void bench_glyph_3x_plain(uint16_t i) {
+  uint16_t offset = (i % 10) * (3 * PLAIN_3X_WIDTH);
+  for (uint8_t j = 0; j < 3 * PLAIN_3X_WIDTH; j++) glyph_sink = pgm_read_byte_near(&plain_3x_bitmap[offset++]);
+}
+
+static void bench_glyph_3x_rle(uint16_t i) {
+  rle_glyph_t rle;
+  rle_glyph_start(rle, rle_3x_bitmap, i % 10);
+  for (uint8_t j = 0; j < 3 * RLE_3X_WIDTH; j++) glyph_sink = rle_glyph_next(rle);
+}
+
+// the run length glyphs must decode to the plain ones
+static bool rle_fonts_match(const uint8_t *plain, const uint8_t *rle_bitmap, uint8_t volume) {
+  for (uint8_t glyph = 0; glyph < 10; glyph++) {
+    rle_glyph_t rle;
+    rle_glyph_start(rle, rle_bitmap, glyph);
+    for (uint8_t j = 0; j < volume; j++) {
+      if (rle_glyph_next(rle) != pgm_read_byte_near(&plain[(glyph * volume) + j])) return false;
+    }
+  }
+  return true;
+}
+
+#ifdef SSD1306_SHAPES
+// a 64 x 32 graph of lines and a frame, new content every time
+static void bench_draw_shapes(uint16_t i) {
+  uint8_t y = i % 32;
+  ssd1306_shape_t shapes[] = {
+    {SHAPE_RECT, 0, 0, 64, 32, NULL},
+    {SHAPE_LINE, 0, 31, 31, y, NULL},
+    {SHAPE_LINE, 31, y, 63, 0, NULL},
+  };
+  oled.draw_shapes(shapes, 3, 0, 0, 64, 4, i);
+}
+#endif
+
+static void bench_draw_oled(uint16_t) {
+  adjustTime(1); // next second
+  draw_oled();
+}
+
+static void bench_draw_oled_full(uint16_t) {
+  oled.fill(0x00); // forget everything on screen
+  draw_oled();
+}
+
+#ifdef WATCH_ANALOG_FACE
+// the analog face drawn whole, then a second at a time as on the watch
+static void bench_draw_analog_full(uint16_t) {
+  display_mode = analog_mode;
+  oled.fill(0x00);
+  analog_face_reset();
+  draw_oled();
+}
+
+static void bench_draw_analog(uint16_t) {
+  adjustTime(1);
+  draw_oled();
+}
+#endif
+
+typedef void (*bench_fn_t)(uint16_t i);
+
+typedef struct {
+  const char *name;
+  bench_fn_t fn;
+} bench_t;
+
+static const char name_breakTime[] PROGMEM = "breakTime";
+static const char name_makeTime[] PROGMEM = "makeTime";
+static const char name_now[] PROGMEM = "now";
+static const char name_getTemp[] PROGMEM = "getTemp";
+static const char name_getVcc[] PROGMEM = "getVcc";
+static const char name_convertVcc[] PROGMEM = "convertVcc";
+static const char name_convertVcc_divide[] PROGMEM = "convertVcc_divide";
+static const char name_convertTemp[] PROGMEM = "convertTemp";
+static const char name_convertTemp_divide[] PROGMEM = "convertTemp_divide";
+static const char name_write[] PROGMEM = "SSD1306::write";
+static const char name_glyph_2x_plain[] PROGMEM = "glyph_2x_plain";
+static const char name_glyph_2x_rle[] PROGMEM = "glyph_2x_rle";
+static const char name_glyph_3x_plain[] PROGMEM = "glyph_3x_plain";
+static const char name_glyph_3x_rle[] PROGMEM = "glyph_3x_rle";
+#ifdef SSD1306_SHAPES
+static const char name_draw_shapes[] PROGMEM = "draw_shapes";
+#endif
+static const char name_draw_oled[] PROGMEM = "draw_oled";
+static const char name_draw_oled_full[] PROGMEM = "draw_oled_full";
+#ifdef WATCH_ANALOG_FACE
+static const char name_draw_analog_full[] PROGMEM = "draw_analog_full";
+static const char name_draw_analog[] PROGMEM = "draw_analog";
+#endif
+
+static const bench_t benches[] = {
+  {name_breakTime, bench_breakTime},
+  {name_makeTime, bench_makeTime},
+  {name_now, bench_now},
+  {name_getTemp, bench_getTemp},
+  {name_getVcc, bench_getVcc},
+  {name_convertVcc, bench_convertVcc},
+  {name_convertVcc_divide, bench_convertVcc_divide},
+  {name_convertTemp, bench_convertTemp},
+  {name_convertTemp_divide, bench_convertTemp_divide},
+  {name_write, bench_write},
+  {name_glyph_2x_plain, bench_glyph_2x_plain},
+  {name_glyph_2x_rle, bench_glyph_2x_rle},
+  {name_glyph_3x_plain, bench_glyph_3x_plain},
+  {name_glyph_3x_rle, bench_glyph_3x_rle},
+#ifdef SSD1306_SHAPES
+  {name_draw_shapes, bench_draw_shapes},
+#endif
+  {name_draw_oled, bench_draw_oled},
+  {name_draw_oled_full, bench_draw_oled_full},
+#ifdef WATCH_ANALOG_FACE
+  {name_draw_analog_full, bench_draw_analog_full},
+  {name_draw_analog, bench_draw_analog},
+#endif
+};
+
+// flash used by each digit font
+typedef struct {
+  const char *name;
+  uint16_t bytes;
+} bench_size_t;
+
+static const char name_font_2x_plain[] PROGMEM = "font_2x_plain";
+static const char name_font_2x_rle[] PROGMEM = "font_2x_rle";
+static const char name_font_3x_plain[] PROGMEM = "font_3x_plain";
+static const char name_font_3x_rle[] PROGMEM = "font_3x_rle";
+
+static const bench_size_t sizes[] = {
+  {name_font_2x_plain, sizeof(plain_2x_bitmap)},
+  {name_font_2x_rle, sizeof(rle_2x_bitmap)},
+  {name_font_3x_plain, sizeof(plain_3x_bitmap)},
+  {name_font_3x_rle, sizeof(rle_3x_bitmap)},
+};
+
+static void bench_print_row(const char *name, uint32_t iterations, const char *unit, uint32_t value) {
+  bench_print(BENCH_TARGET ",");
+  bench_print_number(BENCH_F_CPU);
+  bench_putc(',');
+  bench_print_P(name);
+  bench_putc(',');
+  bench_print_number(iterations);
+  bench_putc(',');
+  bench_print(unit);
+  bench_putc(',');
+  bench_print_number(value);
+  bench_putc('\n');
+}
+
+static bench_ticks_t bench_run(bench_fn_t fn) {
+  bench_ticks_t start = bench_ticks();
+  for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) fn(i);
+  return bench_ticks() - start;
+}
+
+int main(void) {
+#ifdef __AVR__
+  avr_runtime_init();
+#endif
+  setup();
+  setTime(12, 34, 56, 16, 10, 2026);
+  draw_oled(); // first frame
+
+  if (!rle_fonts_match(plain_2x_bitmap, rle_2x_bitmap, 2 * PLAIN_2X_WIDTH)
+      || !rle_fonts_match(plain_3x_bitmap, rle_3x_bitmap, 3 * PLAIN_3X_WIDTH)) {
+    bench_print("run length glyphs differ from the plain font\n");
+    return 1;
+  }
+
+  bench_ticks_t overhead = bench_run(bench_empty);
+
+  bench_print("target,f_cpu,function,iterations,unit,per_call\n");
+  for (uint8_t b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+    bench_ticks_t ticks = bench_run(benches[b].fn);
+    ticks = (ticks > overhead) ? ticks - overhead : 0;
+    bench_print_row(benches[b].name, BENCH_ITERATIONS, BENCH_UNIT, ticks / BENCH_ITERATIONS);
+  }
+  for (uint8_t b = 0; b < sizeof(sizes) / sizeof(sizes[0]); b++) {
+    bench_print_row(sizes[b].name, 1, "bytes", sizes[b].bytes);
+  }
+
+#ifdef __AVR__
+  cli();
+  sleep_cpu(); // simavr stops on sleep with interrupts off
+#endif
+  return 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * Font compiler: turn an ASCII art font from extras/fonts into the PROGMEM
+ * header ssd1306.cpp reads, keeping only the characters the firmware uses.
+ *
+ * Glyphs are stored column by column, each column top page first, the order
+ * the display takes them in vertical addressing mode. When the kept characters
+ * are not one contiguous range a map from code to glyph index is added.
+ *
+ * With -r the glyphs are run length coded instead, see font_rle.h.
+ *
+ * usage: fontc [-r] <font.txt> <PREFIX> [characters] > header.h
+ *   -r           run length coded glyphs
+ *   PREFIX       macro prefix, e.g. FONT or FONT_2X, arrays use it in lower case
+ *   characters   the subset to keep, all glyphs of the source by default
+ * The size before and after subsetting is reported on stderr.
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define NO_GLYPH 0xFF // map entry of a character without glyph, as in ssd1306.cpp
+
+struct glyph_t {
+  int code;
+  std::vector<std::string> rows;
+};
+
+static void fail(const char *file, int line, const char *msg) {
+  fprintf(stderr, "%s:%d: %s\n", file, line, msg);
+  exit(1);
+}
+
+static std::string lower(const std::string &str) {
+  std::string out = str;
+  for (size_t i = 0; i < out.size(); i++) out[i] = tolower(out[i]);
+  return out;
+}
+
+static const char *basename_of(const char *path) {
+  const char *slash = strrchr(path, '/');
+  return slash ? slash + 1 : path;
+}
+
+static std::string code_comment(int code) {
+  char buf[16];
+  if (code == ' ') snprintf(buf, sizeof(buf), "(space)");
+  else snprintf(buf, sizeof(buf), "'%c'", code);
+  return buf;
+}
+
+static void print_bytes(const std::vector<uint8_t> &bytes) {
+  for (size_t i = 0; i < bytes.size(); i++) {
+    if ((i % 12) == 0) printf("  ");
+    printf("0x%02X, ", bytes[i]);
+    if (((i % 12) == 11) || (i == bytes.size() - 1)) printf("\n");
+  }
+}
+
+// alternating dark and lit runs of the glyph pixels, bit 0 of each byte first, 4 bits per run
+static std::vector<uint8_t> rle_glyph(const std::vector<uint8_t> &bytes) {
+  std::vector<uint8_t> runs;
+  uint8_t lit = 0;
+  size_t bits = bytes.size() * 8;
+  size_t end = bits;
+  while ((end > 0) && !(bytes[(end - 1) / 8] & (1 << ((end - 1) % 8)))) end--; // trailing dark is implied
+  for (size_t i = 0; i < end;) {
+    size_t run = 0;
+    while ((i < end) && (((bytes[i / 8] >> (i % 8)) & 1) == lit)) {
+      run++;
+      i++;
+    }
+    while (run > 15) { // a 0 run of the other colour joins two runs
+      runs.push_back(15);
+      runs.push_back(0);
+      run -= 15;
+    }
+    runs.push_back(run);
+    lit ^= 1;
+  }
+  std::vector<uint8_t> packed;
+  for (size_t i = 0; i < runs.size(); i += 2) {
+    packed.push_back(runs[i] | ((i + 1 < runs.size()) ? (runs[i + 1] << 4) : 0));
+  }
+  return packed;
+}
+
+int main(int argc, char *argv[]) {
+  bool rle = false;
+  if ((argc > 1) && !strcmp(argv[1], "-r")) {
+    rle = true;
+    argc--;
+    argv++;
+  }
+  if (argc < 3) {
+    fprintf(stderr, "usage: fontc [-r] <font.txt> <PREFIX> [characters]\n");
+    return 1;
+  }
+  const char *path = argv[1];
+  std::string prefix = argv[2];
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+
+  // parse the ASCII art source
+  int width = 0, height = 0, line_no = 0;
+  std::vector<glyph_t> glyphs;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    line_no++;
+    line[strcspn(line, "\r\n")] = '\0';
+    if ((line[0] == '\0') || (line[0] == '#' && line[1] == ' ')) continue; // blank or comment
+    int value;
+    if (sscanf(line, "width %d", &value) == 1) {
+      width = value;
+    } else if (sscanf(line, "height %d", &value) == 1) {
+      if ((value <= 0) || (value % 8)) fail(path, line_no, "height must be a multiple of 8");
+      height = value;
+    } else if (sscanf(line, "char %d", &value) == 1) {
+      if ((value < 32) || (value > 126)) fail(path, line_no, "character code out of printable ASCII");
+      glyph_t g;
+      g.code = value;
+      glyphs.push_back(g);
+    } else {
+      if (glyphs.empty()) fail(path, line_no, "pixel row before the first char line");
+      if ((int)strlen(line) != width) fail(path, line_no, "pixel row length differs from width");
+      if (strspn(line, "#.") != strlen(line)) fail(path, line_no, "pixel row may only hold '#' and '.'");
+      glyphs.back().rows.push_back(line);
+    }
+  }
+  fclose(f);
+  if (!width || !height || glyphs.empty()) fail(path, line_no, "missing width, height or glyphs");
+  for (size_t i = 0; i < glyphs.size(); i++) {
+    if ((int)glyphs[i].rows.size() != height) fail(path, line_no, "glyph row count differs from height");
+  }
+
+  // pick the subset, in code order
+  std::string chars;
+  if (argc > 3) {
+    chars = argv[3];
+  } else {
+    for (size_t i = 0; i < glyphs.size(); i++) chars += (char)glyphs[i].code;
+  }
+  std::vector<const glyph_t *> kept;
+  for (int code = 32; code <= 126; code++) {
+    if (chars.find((char)code) == std::string::npos) continue;
+    const glyph_t *found = NULL;
+    for (size_t i = 0; i < glyphs.size(); i++) {
+      if (glyphs[i].code == code) found = &glyphs[i];
+    }
+    if (!found) {
+      fprintf(stderr, "%s: no glyph for %s\n", path, code_comment(code).c_str());
+      return 1;
+    }
+    kept.push_back(found);
+  }
+  if (kept.empty() || (kept.size() >= NO_GLYPH)) {
+    fprintf(stderr, "%s: between 1 and %d characters needed\n", path, NO_GLYPH - 1);
+    return 1;
+  }
+
+  // column major, page packed bitmap
+  int pages = height / 8;
+  std::vector<uint8_t> bitmap;
+  for (size_t i = 0; i < kept.size(); i++) {
+    std::vector<uint8_t> glyph;
+    for (int x = 0; x < width; x++) {
+      for (int p = 0; p < pages; p++) {
+        uint8_t data = 0;
+        for (int bit = 0; bit < 8; bit++) {
+          if (kept[i]->rows[(p * 8) + bit][x] == '#') data |= 1 << bit;
+        }
+        glyph.push_back(data);
+      }
+    }
+    if (rle) {
+      glyph = rle_glyph(glyph);
+      if (glyph.size() > 255) {
+        fprintf(stderr, "%s: %s too long for a run length glyph\n", path, code_comment(kept[i]->code).c_str());
+        return 1;
+      }
+      bitmap.push_back(glyph.size());
+    }
+    bitmap.insert(bitmap.end(), glyph.begin(), glyph.end());
+  }
+
+  // map only when the kept codes have holes
+  int start = kept.front()->code, end = kept.back()->code;
+  std::vector<uint8_t> map;
+  if ((end - start + 1) != (int)kept.size()) {
+    map.assign(end - start + 1, NO_GLYPH);
+    for (size_t i = 0; i < kept.size(); i++) map[kept[i]->code - start] = i;
+  }
+
+  std::string name = lower(prefix);
+  std::string subset;
+  for (size_t i = 0; i < kept.size(); i++) subset += (char)kept[i]->code;
+  printf("// generated by extras/host/fontc from extras/fonts/%s, do not edit\n", basename_of(path));
+  printf("#include <avr/pgmspace.h>\n\n");
+  printf("#define %s_WIDTH %d\n", prefix.c_str(), width);
+  printf("#define %s_RANGE_START %d // %s\n", prefix.c_str(), start, code_comment(start).c_str());
+  printf("#define %s_RANGE_END %d // %s\n", prefix.c_str(), end, code_comment(end).c_str());
+  if (rle) printf("#define %s_RLE // run length glyphs, see font_rle.h\n", prefix.c_str());
+  if (!map.empty()) {
+    printf("#define %s_MAP // code - %s_RANGE_START to glyph index, 0x%02X for none\n\n", prefix.c_str(), prefix.c_str(), NO_GLYPH);
+    printf("static const uint8_t %s_map[] PROGMEM = {\n", name.c_str());
+    print_bytes(map);
+    printf("  };\n");
+  }
+  printf("\nstatic const uint8_t %s_bitmap[] PROGMEM = { // %d characters \"%s\"\n", name.c_str(), (int)kept.size(), subset.c_str());
+  print_bytes(bitmap);
+  printf("  };\n");
+
+  size_t full = glyphs.size() * width * pages;
+  size_t now = bitmap.size() + map.size();
+  fprintf(stderr, "%s: %d glyphs %d bytes -> %d glyphs %d bytes%s + %d bytes map, %d bytes flash saved\n",
+          basename_of(path), (int)glyphs.size(), (int)full, (int)kept.size(), (int)bitmap.size(), rle ? " run length" : "", (int)map.size(),
+          (int)full - (int)now);
+  return 0;
+}
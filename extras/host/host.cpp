@@ -0,0 +1,273 @@
+/*
+ * Host (Linux) stand-in for the ATtiny85 and Arduino core
+ */
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <TinyWireM.h>
+#include <avr/sleep.h>
+#include <stdlib.h>
+#include "WDT_Time.h" // calibration constants, to return the raw readings the firmware expects
+
+uint64_t host_time_us = 0;
+uint16_t host_vcc_mv = 3000;
+int32_t host_temp_mc = 25000;
+uint16_t host_button_adc = 1023;
+uint8_t host_sleep_mode = SLEEP_MODE_IDLE;
+
+static void host_no_sleep(uint8_t) {}
+void (*host_sleep_hook)(uint8_t mode) = host_no_sleep;
+
+void host_advance_us(uint32_t us) {
+  host_time_us += us;
+}
+
+// builds without the asynchronous display transfers have no pump interrupts
+extern "C" __attribute__((weak)) void TIMER0_COMPB_vect(void) {}
+extern "C" __attribute__((weak)) void USI_OVF_vect(void) {}
+// nor do builds without the EEPROM journal have the background writer,
+// or builds without WATCH_ADC_INTERRUPT the sampling round interrupt
+extern "C" __attribute__((weak)) void EE_RDY_vect(void) {}
+extern "C" __attribute__((weak)) void ADC_vect(void) {}
+
+// a running Timer0 compare B interrupt (the display transfer pump, an SCL edge each)
+// comes before anything else, its period is not simulated time; a USI counter
+// overflow it causes is served right after it, as long as the flag is set
+void host_sleep(uint8_t mode) {
+  if (TIMSK.value & _BV(OCIE0B)) {
+    TIMER0_COMPB_vect();
+    for (uint8_t i = 0; (USISR.value & _BV(USIOIF)) && (USICR.value & _BV(USIOIE)); i++) {
+      if (i == 16) abort(); // the interrupt does not clear its flag
+      USI_OVF_vect();
+    }
+    return;
+  }
+  host_sleep_hook(mode);
+}
+
+/*
+ * Arduino core
+ */
+unsigned long millis(void) {
+  return (unsigned long)(uint32_t)(host_time_us / 1000);
+}
+
+unsigned long micros(void) {
+  return (unsigned long)(uint32_t)host_time_us;
+}
+
+void delay(unsigned long ms) {
+  host_advance_us(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  host_advance_us(us);
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t) {
+  return (host_button_adc > 512) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t) {
+  return host_button_adc;
+}
+
+/*
+ * ADC, a conversion completes at once when ADSC is set, raising ADC_vect if enabled
+ */
+static void adcsra_hook(uint8_t value);
+
+HostReg8 ADMUX;
+HostReg8 ADCSRA(adcsra_hook);
+static struct host_adc_init {
+  host_adc_init() { ADCSRA.value = _BV(ADEN); } // enabled by Arduino core init()
+} host_adc_init_instance;
+uint16_t ADC = 0;
+
+static uint16_t host_adc_result(uint8_t mux) {
+  if ((mux & 0x0F) == (_BV(MUX3) | _BV(MUX2))) { // 1.1 V bandgap against Vcc
+    uint32_t raw = DEFAULT_VOLTAGE_REF / host_vcc_mv;
+    return (raw > 1023) ? 1023 : raw;
+  } else if ((mux & 0x0F) == 0x0F) { // temperature sensor against 1.1 V
+    // inverse of getTemp(), without the Vcc compensation
+    int64_t accumulated = (((int64_t)host_temp_mc * CHIP_TEMP_COEFF) + CHIP_TEMP_OFFSET) / 100000L;
+    return accumulated >> 6;
+  } else { // button ladder
+    return host_button_adc;
+  }
+}
+
+static void adcsra_hook(uint8_t value) {
+  if ((value & _BV(ADEN)) && (value & _BV(ADSC))) {
+    ADC = host_adc_result(ADMUX);
+    ADCSRA.value = (value & ~_BV(ADSC)) | _BV(ADIF);
+    if (value & _BV(ADIE)) {
+      ADCSRA.value &= ~_BV(ADIF); // cleared when the interrupt is served
+      ADC_vect();
+    }
+  }
+}
+
+/*
+ * watchdog, pin change interrupt, timer 0 compare and timer 1, no peripheral behaviour needed
+ */
+HostReg8 TCNT0;
+HostReg8 OCR0B;
+HostReg8 TCCR1;
+HostReg8 TCNT1;
+HostReg8 OCR1A;
+HostReg8 OCR1C;
+HostReg8 TIMSK;
+HostReg8 TIFR;
+HostReg8 WDTCR;
+HostReg8 MCUSR;
+HostReg8 GIMSK;
+HostReg8 PCMSK;
+
+/*
+ * USI two wire mode on port B, SDA PB0 and SCL PB2, with the I2C bus behind:
+ * the open drain lines are decoded into START, bytes and STOP, every byte is
+ * acknowledged while host_i2c_bus is set, a transaction goes to it at STOP.
+ * Only what a write only master uses: USITC strobes, USIDR shifting on the SCL
+ * rising edge, its MSB latched onto SDA while SCL is low, and the USISR counter
+ * counting the strobes, setting USIOIF as it wraps. The start detector sets
+ * USISIF at any START, the master's own too, and in two wire mode holds SCL low
+ * from its next falling edge until USISIF is cleared. Writing a flag clears it.
+ */
+#define HOST_SDA PB0
+#define HOST_SCL PB2
+#define HOST_I2C_MAX 1100 // a whole 128x64 frame and its header
+
+static void usi_lines();
+static void usicr_hook(uint8_t value);
+static void usi_lines_hook(uint8_t) { usi_lines(); }
+
+HostReg8 PORTB(usi_lines_hook);
+HostReg8 DDRB(usi_lines_hook);
+HostReg8 PINB;
+HostReg8 USIDR(usi_lines_hook);
+static void usisr_hook(uint8_t value);
+HostReg8 USISR(usisr_hook);
+HostReg8 USICR(usicr_hook);
+
+static bool line_scl = true, line_sda = true; // pulled up
+static bool usi_latch = true; // USIDR MSB driving SDA
+static bool slave_ack = false; // slave pulls SDA low
+static bool i2c_active = false; // between START and STOP
+static uint8_t i2c_bits = 0; // of the current byte, 8 while acknowledging
+static uint8_t i2c_byte = 0;
+static uint8_t i2c_buf[HOST_I2C_MAX]; // address byte first
+static uint16_t i2c_len = 0;
+static uint8_t usi_flags = 0; // USISR flags, the register only holds what was written last
+
+static void i2c_deliver() {
+  if (i2c_active && (i2c_len > 0) && host_i2c_bus) {
+    host_i2c_bus->transaction(i2c_buf[0] >> 1, &i2c_buf[1], i2c_len - 1);
+  }
+}
+
+static void i2c_edges(bool scl, bool sda) {
+  if (scl && line_scl && (sda != line_sda)) { // SDA changes while SCL high
+    i2c_deliver(); // a repeated START ends the previous transaction too
+    i2c_active = !sda; // falling: START, rising: STOP
+    if (!sda) {
+      usi_flags |= _BV(USISIF);
+      USISR.value |= _BV(USISIF);
+    }
+    i2c_bits = 0;
+    i2c_len = 0;
+  } else if (i2c_active && scl && !line_scl) { // rising, the slave samples SDA
+    if (i2c_bits < 8) {
+      i2c_byte = (i2c_byte << 1) | sda;
+      if (++i2c_bits == 8) {
+        if (i2c_len < HOST_I2C_MAX) i2c_buf[i2c_len++] = i2c_byte;
+      }
+    } else {
+      i2c_bits = 9; // acknowledge clock
+    }
+  } else if (i2c_active && !scl && line_scl) { // falling
+    if (i2c_bits == 8) {
+      slave_ack = (host_i2c_bus != 0);
+    } else if (i2c_bits == 9) {
+      slave_ack = false;
+      i2c_bits = 0;
+    }
+  }
+  line_scl = scl;
+  line_sda = sda;
+}
+
+static void usi_lines() {
+  uint8_t port = PORTB.value;
+  uint8_t ddr = DDRB.value;
+  bool two_wire = USICR.value & _BV(USIWM1);
+  bool scl = !((ddr & _BV(HOST_SCL)) && !(port & _BV(HOST_SCL)));
+  if (two_wire && (usi_flags & _BV(USISIF)) && !line_scl) scl = false; // held by the start detector
+  if (!scl) usi_latch = USIDR.value & 0x80;
+  for (uint8_t settle = 0; settle < 2; settle++) { // the slave may answer an edge
+    bool sda = !(((ddr & _BV(HOST_SDA)) && (!(port & _BV(HOST_SDA)) || (two_wire && !usi_latch))) || slave_ack);
+    bool rising = scl && !line_scl;
+    i2c_edges(scl, sda);
+    if (rising && two_wire && (USICR.value & _BV(USICS1))) {
+      USIDR.value = (USIDR.value << 1) | sda;
+    }
+  }
+  PINB.value = (port & ~(_BV(HOST_SDA) | _BV(HOST_SCL))) | (line_sda ? _BV(HOST_SDA) : 0) | (line_scl ? _BV(HOST_SCL) : 0);
+}
+
+static void usicr_hook(uint8_t value) {
+  USICR.value = value & ~_BV(USITC); // reads as 0
+  if (value & _BV(USITC)) {
+    PORTB = PORTB.value ^ _BV(HOST_SCL);
+    uint8_t count = (USISR.value + 1) & 0x0F;
+    if (count == 0) usi_flags |= _BV(USIOIF);
+    USISR.value = usi_flags | count;
+  } else {
+    usi_lines();
+  }
+}
+
+// a flag written one clears, the counter takes the value written
+static void usisr_hook(uint8_t value) {
+  usi_flags &= ~(value & 0xF0);
+  USISR.value = usi_flags | (value & 0x0F);
+  usi_lines(); // SCL goes up if the start detector held it
+}
+
+/*
+ * EEPROM, erased chip reads 0xFF
+ */
+uint8_t host_eeprom[HOST_EEPROM_SIZE];
+uint32_t host_eeprom_cell_writes[HOST_EEPROM_SIZE];
+
+static struct host_eeprom_init {
+  host_eeprom_init() { memset(host_eeprom, 0xFF, sizeof(host_eeprom)); }
+} host_eeprom_init_instance;
+
+/*
+ * EEPROM registers, a write completes at once, raising EE_RDY_vect if enabled
+ * as the EEPROM is ready again, or when EERIE is turned on
+ */
+static void eecr_hook(uint8_t value);
+
+uint16_t EEAR = 0;
+HostReg8 EEDR;
+HostReg8 EECR(eecr_hook);
+
+static void eecr_hook(uint8_t value) {
+  static bool ready_enabled = false;
+  bool raise = (value & _BV(EERIE)) && !ready_enabled;
+  ready_enabled = value & _BV(EERIE);
+  if (value & _BV(EERE)) {
+    EEDR.value = host_eeprom_read(EEAR);
+    EECR.value &= ~_BV(EERE);
+  }
+  if ((value & _BV(EEMPE)) && (value & _BV(EEPE))) {
+    host_eeprom_write(EEAR, EEDR.value);
+    host_eeprom_writes++;
+    EECR.value &= ~(_BV(EEMPE) | _BV(EEPE));
+    raise = ready_enabled;
+  }
+  if (raise) EE_RDY_vect();
+}
@@ -0,0 +1,32 @@
+/*
+ * Host (Linux) stand-in for the ATtiny85 and Arduino core
+ * Simulated MCU state shared by the stand-in headers in this folder,
+ * used to build the watch firmware with g++ for benchmark and emulation.
+ */
+#ifndef _host_h
+#define _host_h
+
+#include <stdint.h>
+
+// simulated time since power on
+extern uint64_t host_time_us;
+void host_advance_us(uint32_t us);
+
+// simulated analog inputs
+extern uint16_t host_vcc_mv;     // supply voltage
+extern int32_t host_temp_mc;     // chip temperature in milli degree Celsius
+extern uint16_t host_button_adc; // button ladder reading, 1023 = released
+
+// sleep hook, called by sleep_mode() unless the display transfer pump wakes the CPU first, default returns at once
+extern void (*host_sleep_hook)(uint8_t mode);
+void host_sleep(uint8_t mode);
+
+// interrupt vectors implemented by the firmware
+extern "C" void WDT_vect(void);
+extern "C" void PCINT0_vect(void);
+extern "C" void ADC_vect(void);
+extern "C" void EE_RDY_vect(void);
+extern "C" void TIMER0_COMPB_vect(void);
+extern "C" void USI_OVF_vect(void);
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for <avr/interrupt.h>
+ * An ISR becomes a plain function the host driver calls to raise the interrupt.
+ */
+#ifndef _host_avr_interrupt_h
+#define _host_avr_interrupt_h
+
+#define ISR(vector) extern "C" void vector(void)
+#define sei()
+#define cli()
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Host stand-in for <avr/io.h>, ATtiny85 registers used by the firmware
+ * Registers are plain bytes, a write hook let host.cpp model the peripheral behind.
+ */
+#ifndef _host_avr_io_h
+#define _host_avr_io_h
+
+#include <stdint.h>
+
+class HostReg8 {
+  public:
+    HostReg8(void (*set_hook)(uint8_t) = 0) : value(0), hook(set_hook) {}
+    operator uint8_t() const { return value; }
+    HostReg8 &operator=(uint8_t v) { value = v; if (hook) hook(v); return *this; }
+    // int as the AVR compound assignments, ~_BV(bit) is a negative int
+    HostReg8 &operator|=(int v) { return *this = (uint8_t)(value | v); }
+    HostReg8 &operator&=(int v) { return *this = (uint8_t)(value & v); }
+
+    uint8_t value;
+    void (*hook)(uint8_t);
+};
+
+#define _BV(bit) (1 << (bit))
+#define _SFR_BYTE(sfr) (sfr)
+#define bit_is_set(sfr, bit) ((uint8_t)(sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((uint8_t)(sfr) & _BV(bit)))
+
+// ADC
+extern HostReg8 ADMUX;
+extern HostReg8 ADCSRA;
+extern uint16_t ADC;
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define REFS2 4
+#define MUX3 3
+#define MUX2 2
+#define MUX1 1
+#define MUX0 0
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+
+// watchdog and reset
+extern HostReg8 WDTCR;
+extern HostReg8 MCUSR;
+#define WDIF 7
+#define WDIE 6
+#define WDP3 5
+#define WDCE 4
+#define WDE 3
+#define WDP2 2
+#define WDP1 1
+#define WDP0 0
+#define WDRF 3
+
+// pin change interrupt
+extern HostReg8 GIMSK;
+extern HostReg8 PCMSK;
+#define INT0 6
+#define PCIE 5
+#define PCINT5 5
+#define PCINT4 4
+#define PCINT3 3
+#define PCINT2 2
+#define PCINT1 1
+#define PCINT0 0
+
+// port B
+extern HostReg8 PORTB;
+extern HostReg8 DDRB;
+extern HostReg8 PINB;
+#define PB5 5
+#define PB4 4
+#define PB3 3
+#define PB2 2
+#define PB1 1
+#define PB0 0
+
+// USI
+extern HostReg8 USIDR;
+extern HostReg8 USISR;
+extern HostReg8 USICR;
+#define USISIF 7
+#define USIOIF 6
+#define USIPF 5
+#define USIDC 4
+#define USICNT0 0
+#define USISIE 7
+#define USIOIE 6
+#define USIWM1 5
+#define USIWM0 4
+#define USICS1 3
+#define USICS0 2
+#define USICLK 1
+#define USITC 0
+
+// timer 0 compare B, the display transfer pump, timer 1 and the interrupt mask
+extern HostReg8 TCNT0;
+extern HostReg8 OCR0B;
+extern HostReg8 TCCR1;
+extern HostReg8 TCNT1;
+extern HostReg8 OCR1A;
+extern HostReg8 OCR1C;
+extern HostReg8 TIMSK;
+extern HostReg8 TIFR;
+#define CTC1 7
+#define PWM1A 6
+#define CS13 3
+#define CS12 2
+#define CS11 1
+#define CS10 0
+#define OCIE1A 6
+#define OCIE1B 5
+#define OCIE0B 3
+#define TOIE1 2
+#define TOIE0 1
+#define OCF1A 6
+#define OCF0B 3
+
+// EEPROM
+#define E2END 0x1FF
+extern uint16_t EEAR;
+extern HostReg8 EEDR;
+extern HostReg8 EECR;
+#define EEPM1 5
+#define EEPM0 4
+#define EERIE 3
+#define EEMPE 2
+#define EEPE 1
+#define EERE 0
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * Host stand-in for <avr/pgmspace.h>, flash and RAM share one address space
+ */
+#ifndef _host_avr_pgmspace_h
+#define _host_avr_pgmspace_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_word_near(addr) pgm_read_word(addr)
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_dword_near(addr) pgm_read_dword(addr)
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+
+#endif
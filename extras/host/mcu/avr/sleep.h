@@ -0,0 +1,23 @@
+/*
+ * Host stand-in for <avr/sleep.h>
+ * sleep_mode() hands over to host_sleep(), which serves a running Timer0 compare B
+ * interrupt first, else host_sleep_hook, so a driver can advance simulated time.
+ */
+#ifndef _host_avr_sleep_h
+#define _host_avr_sleep_h
+
+#include "../../host.h"
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_ADC 1
+#define SLEEP_MODE_PWR_DOWN 2
+
+extern uint8_t host_sleep_mode;
+
+#define set_sleep_mode(mode) (host_sleep_mode = (mode))
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu() host_sleep(host_sleep_mode)
+#define sleep_mode() host_sleep(host_sleep_mode)
+
+#endif
@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for <avr/wdt.h>
+ */
+#ifndef _host_avr_wdt_h
+#define _host_avr_wdt_h
+
+#define wdt_reset()
+
+#endif
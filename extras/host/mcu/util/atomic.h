@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for <util/atomic.h>, interrupts are raised by the host driver
+ * between calls, so the block only has to run its body once
+ */
+#ifndef _host_util_atomic_h
+#define _host_util_atomic_h
+
+#include <inttypes.h>
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) for (uint8_t _atomic_once = 1; _atomic_once; _atomic_once = 0)
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for <util/delay.h>, busy waits take no simulated time
+ */
+#ifndef _host_util_delay_h
+#define _host_util_delay_h
+
+#ifndef F_CPU
+#define F_CPU 8000000UL // as avr-libc does when the build sets none
+#endif
+
+#define _delay_us(us) ((void)(us))
+#define _delay_ms(ms) ((void)(ms))
+
+#endif
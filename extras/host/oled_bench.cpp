@@ -0,0 +1,117 @@
+/*
+ * Run the watch firmware on host against the SSD1306 emulator and report
+ * I2C bus cost of draw_oled() per frame, optionally dump or compare the
+ * panel image (PBM) to catch rendering regressions.
+ *
+ * usage: oled_bench [-s seconds] [-f frames_per_second] [-m time|analog|debug|power] [-e field]
+ *                   [-v vcc_mv] [-o dump.pbm] [-c reference.pbm]
+ * analog and power are pages of a build with WATCH_ANALOG_FACE and WATCH_POWER_PAGE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ATtinyWatch.cpp" // generated from ATtinyWatch.ino by the Makefile
+#include "ssd1306_emu.h"
+
+#ifndef XOFFSET
+  #define XOFFSET 0
+#endif
+
+static SSD1306Emulator emu(SSD1306_I2C_ADDR, WIDTH, PAGES, XOFFSET);
+
+// the frame queued by the asynchronous display transfers is all on the bus
+static void frame_sent() {
+  while (oled.busy()) system_idle();
+}
+
+static void print_stat(const char *name, const ssd1306_bus_stat_t &stat, uint32_t frames) {
+  printf("%s: %lu frame(s), %.1f transactions, %.1f bytes (%.1f command, %.1f data) per frame\n",
+         name, (unsigned long)frames,
+         (double)stat.transactions / frames, (double)stat.bytes / frames,
+         (double)stat.command_bytes / frames, (double)stat.data_bytes / frames);
+  printf("%s: bus time per frame %.1f us @100kHz, %.1f us @400kHz\n", name,
+         (double)SSD1306Emulator::bus_time_us(stat, 100000) / frames,
+         (double)SSD1306Emulator::bus_time_us(stat, 400000) / frames);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t seconds = 60;
+  uint32_t fps = 1;
+  const char *dump = NULL;
+  const char *reference = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if ((!strcmp(argv[i], "-s")) && (i + 1 < argc)) {
+      seconds = strtoul(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-f")) && (i + 1 < argc)) {
+      fps = strtoul(argv[++i], NULL, 10);
+    } else if ((!strcmp(argv[i], "-m")) && (i + 1 < argc)) {
+      i++;
+      display_mode = (!strcmp(argv[i], "debug")) ? debug_mode : time_mode;
+#ifdef WATCH_ANALOG_FACE
+      if (!strcmp(argv[i], "analog")) display_mode = analog_mode;
+#endif
+#ifdef WATCH_POWER_PAGE
+      if (!strcmp(argv[i], "power")) display_mode = power_mode;
+#endif
+    } else if ((!strcmp(argv[i], "-e")) && (i + 1 < argc)) {
+      selected_field = atoi(argv[++i]);
+    } else if ((!strcmp(argv[i], "-v")) && (i + 1 < argc)) {
+      host_vcc_mv = atoi(argv[++i]);
+    } else if ((!strcmp(argv[i], "-o")) && (i + 1 < argc)) {
+      dump = argv[++i];
+    } else if ((!strcmp(argv[i], "-c")) && (i + 1 < argc)) {
+      reference = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [-s seconds] [-f frames_per_second] [-m time|analog|debug|power] [-e field] [-v vcc_mv] [-o dump.pbm] [-c reference.pbm]\n", argv[0]);
+      return 2;
+    }
+  }
+  if ((seconds == 0) || (fps == 0)) return 2;
+
+  host_i2c_bus = &emu;
+  setup();
+  frame_sent();
+  setTime(12, 34, 56, 16, 10, 2026);
+
+  // first frame after power on draw everything
+  emu.reset_stat();
+  set_display_timeout();
+  loop();
+  frame_sent();
+  print_stat("first", emu.stat, 1);
+
+  // steady state, the awake path of loop() as the watch runs it
+  emu.reset_stat();
+  uint32_t sent_bytes = oled.get_sent_bytes();
+  uint32_t skipped_bytes = oled.get_skipped_bytes();
+  for (uint32_t s = 0; s < seconds; s++) {
+    WDT_vect(); // one watchdog interrupt, ~1 second
+    for (uint32_t f = 0; f < fps; f++) {
+      host_advance_us(1000000UL / fps);
+      set_display_timeout();
+      loop();
+      frame_sent();
+    }
+  }
+  print_stat("steady", emu.stat, seconds * fps);
+  printf("steady: bus time per second %.1f us @100kHz, %.1f us @400kHz\n",
+         (double)SSD1306Emulator::bus_time_us(emu.stat, 100000) / seconds,
+         (double)SSD1306Emulator::bus_time_us(emu.stat, 400000) / seconds);
+  printf("steady: driver sent %lu bytes, skipped %lu bytes\n",
+         (unsigned long)(oled.get_sent_bytes() - sent_bytes), (unsigned long)(oled.get_skipped_bytes() - skipped_bytes));
+#ifdef SSD1306_POWER_PROFILES
+  printf("panel: power profile %u, estimated %u uA\n", oled.get_power_profile(), SSD1306::power_profile_ua(oled.get_power_profile()));
+#endif
+  if (emu.unknown_commands) printf("warning: %lu unknown command(s)\n", (unsigned long)emu.unknown_commands);
+
+  if (dump && !emu.write_pbm(dump)) {
+    fprintf(stderr, "cannot write %s\n", dump);
+    return 1;
+  }
+  if (reference && !emu.same_as_pbm(reference)) {
+    fprintf(stderr, "panel differs from %s\n", reference);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Compare the division free sensor conversions against the previous formulas,
+ * evaluated in 64 bits as they were meant: Vcc for every 10-bit reading,
+ * temperature for every accumulated reading at each Vcc step of the
+ * compensation, whole degrees and the battery bar over their input range.
+ * Every result must be within +/- 1 of the previous one. Built with
+ * WATCH_DIVISION_FREE, the Vcc table and the whole degree reciprocal.
+ * The cycle cost on the ATtiny85 is in firmware_bench (make avr-bench).
+ *
+ * usage: sensor_bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "ATtinyWatch.cpp" // generated from ATtinyWatch.ino by the Makefile, for battery_level()
+
+/*
+ * previous implementation
+ */
+static int64_t legacyVcc(uint16_t raw) {
+  return DEFAULT_VOLTAGE_REF / raw;
+}
+
+static int64_t legacyTemp(uint16_t accumulated, uint32_t vcc) {
+  int64_t compensation = (vcc < 1700) ? 0 : ((vcc > 3000) ? 1000 : (vcc - 1700) * 10 / 13);
+  return ((((int64_t)accumulated * 100000) - (int64_t)CHIP_TEMP_OFFSET) / CHIP_TEMP_COEFF) + compensation;
+}
+
+static int64_t legacyBatteryLevel(uint32_t vcc) {
+  return (vcc >= 3000) ? 8 : ((vcc <= 1800) ? 1 : ((vcc - 1800 + 150) / 150));
+}
+
+// worst difference of a conversion, and where
+typedef struct {
+  const char *name;
+  int64_t worst;
+  int64_t at;
+  uint32_t count;
+} sweep_t;
+
+static void check(sweep_t &sweep, int64_t input, int64_t expected, int64_t result) {
+  int64_t difference = llabs(result - expected);
+  if (difference > sweep.worst) {
+    sweep.worst = difference;
+    sweep.at = input;
+  }
+  sweep.count++;
+}
+
+int main() {
+  sweep_t sweeps[4] = {{"convertVcc", 0, 0, 0}, {"convertTemp", 0, 0, 0}, {"milliToWhole", 0, 0, 0}, {"battery_level", 0, 0, 0}};
+
+  for (uint16_t raw = 1; raw < 1024; raw++) {
+    check(sweeps[0], raw, legacyVcc(raw), convertVcc(raw));
+  }
+  // every accumulated value, at each Vcc where the compensation steps and outside its range
+  for (uint32_t vcc = 1600; vcc <= 3100; vcc++) {
+    if ((vcc > 1700) && (vcc < 3000) && (((vcc - 1700) * 10 % 13) >= 10)) continue; // same compensation as vcc - 1
+    for (uint32_t accumulated = 0; accumulated <= 0xFFFF; accumulated++) {
+      check(sweeps[1], accumulated, legacyTemp(accumulated, vcc), convertTemp(accumulated, vcc));
+    }
+  }
+  for (int32_t milli = -127999; milli <= 127999; milli++) {
+    check(sweeps[2], milli, milli / 1000, milliToWhole(milli));
+  }
+  for (uint32_t vcc = 0; vcc <= 6000; vcc++) {
+    check(sweeps[3], vcc, legacyBatteryLevel(vcc), battery_level(vcc));
+  }
+
+  bool ok = true;
+  printf("function,inputs,worst_difference,at\n");
+  for (uint8_t i = 0; i < 4; i++) {
+    printf("%s,%lu,%lld,%lld\n", sweeps[i].name, (unsigned long)sweeps[i].count, (long long)sweeps[i].worst, (long long)sweeps[i].at);
+    if (sweeps[i].worst > 1) ok = false;
+  }
+  if (!ok) printf("difference over 1\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+/*
+ * SSD1306 controller emulator for host builds
+ */
+#include <string.h>
+#include "ssd1306_emu.h"
+
+SSD1306Emulator::SSD1306Emulator(uint8_t set_i2c_addr, uint8_t set_width, uint8_t set_pages, uint8_t set_xoffset)
+  : display_on(false), contrast(0x7F), precharge(0x22), vcomh(0x20), clock(0x80),
+    mux_ratio(63), display_offset(0), addressing_mode(2),
+    col_start(0), col_end(EMU_GDDRAM_WIDTH - 1), page_start(0), page_end(EMU_GDDRAM_PAGES - 1),
+    col(0), page(0), unknown_commands(0),
+    i2c_addr(set_i2c_addr), width(set_width), pages(set_pages), xoffset(set_xoffset),
+    cmd_len(0), cmd_need(0)
+{
+  memset(gddram, 0, sizeof(gddram)); // power on content is random, start from black
+  reset_stat();
+}
+
+void SSD1306Emulator::reset_stat() {
+  memset(&stat, 0, sizeof(stat));
+}
+
+uint32_t SSD1306Emulator::bus_time_us(const ssd1306_bus_stat_t &s, uint32_t scl_hz) {
+  // 9 clocks per byte (8 bits + ACK), START and STOP about one clock each,
+  // plus bus free time between STOP and START: 4.7 us standard mode, 1.3 us fast mode
+  uint64_t clocks = ((uint64_t)s.bytes * 9) + ((uint64_t)s.transactions * 2);
+  uint64_t ns = (clocks * 1000000000ULL / scl_hz) + ((uint64_t)s.transactions * ((scl_hz > 100000) ? 1300 : 4700));
+  return (uint32_t)(ns / 1000);
+}
+
+void SSD1306Emulator::transaction(uint8_t addr, const uint8_t *buf, uint16_t len) {
+  if (addr != i2c_addr) return; // not for us, NACK
+  stat.transactions++;
+  stat.bytes += 1 + len;
+
+  // control byte: bit 7 Co (1 = only one byte follows before next control byte), bit 6 D/C#
+  uint16_t i = 0;
+  while (i < len) {
+    uint8_t control = buf[i++];
+    bool co = control & 0x80;
+    bool is_data = control & 0x40;
+    do {
+      if (i >= len) break;
+      if (is_data) {
+        stat.data_bytes++;
+        data(buf[i++]);
+      } else {
+        stat.command_bytes++;
+        command(buf[i++]);
+      }
+    } while (!co);
+  }
+}
+
+// number of parameter bytes following a command byte
+static uint8_t command_params(uint8_t c) {
+  switch (c) {
+    case 0x20: // addressing mode
+    case 0x81: // contrast
+    case 0x8D: // charge pump
+    case 0xA8: // multiplex ratio
+    case 0xD3: // display offset
+    case 0xD5: // clock divide
+    case 0xD9: // pre-charge period
+    case 0xDA: // COM pins
+    case 0xDB: // VCOMH level
+      return 1;
+    case 0x21: // column address
+    case 0x22: // page address
+    case 0xA3: // vertical scroll area
+      return 2;
+    case 0x29: // vertical and horizontal scroll
+    case 0x2A:
+      return 5;
+    case 0x26: // horizontal scroll
+    case 0x27:
+      return 6;
+    default:
+      return 0;
+  }
+}
+
+void SSD1306Emulator::command(uint8_t c) {
+  if (cmd_need == 0) {
+    cmd_len = 0;
+    cmd_need = command_params(c) + 1;
+  }
+  cmd_buf[cmd_len++] = c;
+  if (cmd_len < cmd_need) return; // wait for parameters, may arrive in later transactions
+  cmd_need = 0;
+
+  switch (cmd_buf[0]) {
+    case 0x20:
+      addressing_mode = cmd_buf[1] & 0x03;
+      break;
+    case 0x21:
+      col_start = cmd_buf[1] & 0x7F;
+      col_end = cmd_buf[2] & 0x7F;
+      col = col_start;
+      break;
+    case 0x22:
+      page_start = cmd_buf[1] & 0x07;
+      page_end = cmd_buf[2] & 0x07;
+      page = page_start;
+      break;
+    case 0x81:
+      contrast = cmd_buf[1];
+      break;
+    case 0xA8:
+      mux_ratio = cmd_buf[1] & 0x3F;
+      break;
+    case 0xD3:
+      display_offset = cmd_buf[1] & 0x3F;
+      break;
+    case 0xD5:
+      clock = cmd_buf[1];
+      break;
+    case 0xD9:
+      precharge = cmd_buf[1];
+      break;
+    case 0xDB:
+      vcomh = cmd_buf[1];
+      break;
+    case 0xAE:
+      display_on = false;
+      break;
+    case 0xAF:
+      display_on = true;
+      break;
+    default:
+      if ((addressing_mode == 2) && (cmd_buf[0] <= 0x0F)) { // page mode lower column
+        col = (col & 0xF0) | cmd_buf[0];
+      } else if ((addressing_mode == 2) && (cmd_buf[0] >= 0x10) && (cmd_buf[0] <= 0x1F)) { // page mode higher column
+        col = (col & 0x0F) | ((cmd_buf[0] & 0x0F) << 4);
+      } else if ((addressing_mode == 2) && (cmd_buf[0] >= 0xB0) && (cmd_buf[0] <= 0xB7)) { // page mode page start
+        page = cmd_buf[0] & 0x07;
+      } else if ((cmd_buf[0] >= 0x40) && (cmd_buf[0] <= 0x7F)) { // display start line
+      } else if ((cmd_buf[0] >= 0xA0) && (cmd_buf[0] <= 0xA7)) { // remap, entire display on, inverse
+      } else if ((cmd_buf[0] == 0xC0) || (cmd_buf[0] == 0xC8) || (cmd_buf[0] == 0x2E) || (cmd_buf[0] == 0x2F)) {
+      } else if (command_params(cmd_buf[0]) == 0) {
+        unknown_commands++;
+      }
+      break;
+  }
+}
+
+void SSD1306Emulator::data(uint8_t d) {
+  gddram[page & 0x07][col & 0x7F] = d;
+
+  if (addressing_mode == 0) { // horizontal
+    if (col >= col_end) {
+      col = col_start;
+      page = (page >= page_end) ? page_start : page + 1;
+    } else {
+      col++;
+    }
+  } else if (addressing_mode == 1) { // vertical
+    if (page >= page_end) {
+      page = page_start;
+      col = (col >= col_end) ? col_start : col + 1;
+    } else {
+      page++;
+    }
+  } else { // page, column wraps within the page
+    col = (col + 1) & 0x7F;
+  }
+}
+
+// segment remap (A1) and COM scan flip (C8) are matched by the panel mounting,
+// so the visible panel shows GDDRAM columns xoffset.. and pages 0.. as drawn;
+// only the first MUX ratio + 1 rows are driven, from the display offset row on
+uint8_t SSD1306Emulator::pixel(uint8_t x, uint8_t y) const {
+  if ((!display_on) || (y > mux_ratio)) return 0;
+  uint8_t row = (y + display_offset) & 0x3F;
+  return (gddram[row >> 3][xoffset + x] >> (row & 7)) & 1;
+}
+
+bool SSD1306Emulator::write_pbm(FILE *f) const {
+  uint8_t h = pages * 8;
+  fprintf(f, "P1\n%u %u\n", width, h);
+  for (uint8_t y = 0; y < h; y++) {
+    for (uint8_t x = 0; x < width; x++) {
+      fputc(pixel(x, y) ? '1' : '0', f);
+      fputc((x == width - 1) ? '\n' : ' ', f);
+    }
+  }
+  return !ferror(f);
+}
+
+bool SSD1306Emulator::write_pbm(const char *filename) const {
+  FILE *f = fopen(filename, "w");
+  if (!f) return false;
+  bool ok = write_pbm(f);
+  return (fclose(f) == 0) && ok;
+}
+
+bool SSD1306Emulator::same_as_pbm(const char *filename) const {
+  FILE *f = fopen(filename, "r");
+  if (!f) return false;
+  unsigned int w, h;
+  bool same = (fscanf(f, " P1 %u %u", &w, &h) == 2) && (w == width) && (h == (unsigned int)pages * 8);
+  for (uint8_t y = 0; same && (y < h); y++) {
+    for (uint8_t x = 0; same && (x < w); x++) {
+      int c;
+      do {
+        c = fgetc(f);
+      } while ((c == ' ') || (c == '\n') || (c == '\r') || (c == '\t'));
+      same = (c == (pixel(x, y) ? '1' : '0'));
+    }
+  }
+  fclose(f);
+  return same;
+}
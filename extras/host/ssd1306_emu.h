@@ -0,0 +1,62 @@
+/*
+ * SSD1306 controller emulator for host builds
+ * Decode the I2C command/data stream sent by ssd1306.cpp into a GDDRAM model,
+ * count bus traffic and dump the visible panel area as PBM image.
+ * Ref.:
+ * SSD1306 data sheet: https://www.adafruit.com/datasheets/SSD1306.pdf
+ */
+#ifndef _ssd1306_emu_h
+#define _ssd1306_emu_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <TinyWireM.h>
+
+#define EMU_GDDRAM_WIDTH 128
+#define EMU_GDDRAM_PAGES 8
+
+typedef struct {
+  uint32_t transactions;
+  uint32_t bytes;          // address byte included
+  uint32_t command_bytes;
+  uint32_t data_bytes;
+} ssd1306_bus_stat_t;
+
+class SSD1306Emulator : public HostI2CDevice {
+  public:
+    SSD1306Emulator(uint8_t i2c_addr, uint8_t width, uint8_t pages, uint8_t xoffset);
+    virtual void transaction(uint8_t addr, const uint8_t *data, uint16_t len);
+
+    // bus time, each transaction START + bytes with ACK + STOP and bus free time
+    static uint32_t bus_time_us(const ssd1306_bus_stat_t &stat, uint32_t scl_hz);
+    void reset_stat();
+
+    uint8_t pixel(uint8_t x, uint8_t y) const; // visible panel coordinate
+    bool write_pbm(FILE *f) const;
+    bool write_pbm(const char *filename) const;
+    bool same_as_pbm(const char *filename) const;
+
+    ssd1306_bus_stat_t stat;
+    uint8_t gddram[EMU_GDDRAM_PAGES][EMU_GDDRAM_WIDTH];
+    bool display_on;
+    uint8_t contrast;
+    uint8_t precharge, vcomh, clock;
+    uint8_t mux_ratio;       // rows shown - 1
+    uint8_t display_offset;  // GDDRAM row on the first row
+    uint8_t addressing_mode; // 0 horizontal, 1 vertical, 2 page
+    uint8_t col_start, col_end, page_start, page_end;
+    uint8_t col, page;       // GDDRAM pointer
+    uint32_t unknown_commands;
+
+  private:
+    void command(uint8_t c);
+    void data(uint8_t d);
+
+    uint8_t i2c_addr;
+    uint8_t width, pages, xoffset;
+    uint8_t cmd_buf[8];
+    uint8_t cmd_len;
+    uint8_t cmd_need;
+};
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * Run the whole watch firmware on host for days of simulated time: a watchdog
+ * oscillator with an error that follows temperature and Vcc, scripted button
+ * presses, temperature and Vcc curves, and a user who sets the time right now
+ * and then so wdt_auto_tune() learns. Report clock drift, wake ups, awake time
+ * and EEPROM writes per report period.
+ *
+ * The oscillator error in ppm is error + temp_coeff * (T - 25 C) + vcc_coeff * (Vcc - 3 V),
+ * the temperature a daily sine peaking at 15:00, Vcc a straight line over the run.
+ * A glance is a 200 ms set button press, a sync a user setting the time right
+ * through the buttons (applied at once, it takes no awake time). A daily alarm
+ * wakes the display at its time of day on the watch clock, in a build with
+ * WATCH_ALARMS (make sim SIM_FEATURES=-DWATCH_ALARMS).
+ *
+ * script lines, times in seconds from the start, # for comments:
+ *   3600 set 200     hold set for 200 ms
+ *   4000 up 3000     hold up for 3 s
+ *   86400 sync       set the time right
+ *
+ * usage: watch_sim [-d days] [-e ppm] [-k ppm_per_C] [-u ppm_per_V] [-T mean_C:swing_C]
+ *                  [-V start_mV:end_mV] [-g glance_minutes] [-s sync_hours] [-a hour:minute]
+ *                  [-p script] [-r report_hours]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "ATtinyWatch.cpp" // generated from ATtinyWatch.ino by the Makefile
+#include "../../WDT_Time.cpp" // built in, to read the phase of the running second
+
+#define SIM_START_TIME 1791979200UL // 2026-10-14 12:00:00, the true time at power on
+#define SIM_IDLE_US 1000 // idle sleep ends at the next millis() timer interrupt
+#define SIM_STEP_US 500000 // a drift change this large between ticks is the time being set
+
+// button ladder readings, see the thresholds in Button.h
+#define SIM_ADC_RELEASED 1023
+#define SIM_ADC_SET 50
+#define SIM_ADC_UP 300
+#define SIM_ADC_DOWN 800
+
+typedef enum {
+  sim_button, sim_sync
+} sim_action_t;
+
+typedef struct {
+  uint64_t us; // simulated time
+  sim_action_t action;
+  uint16_t adc; // button ladder reading from then on
+} sim_event_t;
+
+static bool operator<(const sim_event_t &a, const sim_event_t &b) {
+  return a.us < b.us;
+}
+
+// simulation settings
+static double days = 7;
+static double error_ppm = 10000;
+static double temp_ppm = 200; // per degree C
+static double vcc_ppm = 10000; // per volt
+static double temp_mean = 25, temp_swing = 6; // degree C
+static double vcc_start = 3000, vcc_end = 2700; // millivolt
+static double glance_minutes = 30;
+static double sync_hours = 24;
+static double alarm_hour = -1, alarm_minute = 0; // daily alarm, none by default
+static double report_hours = 24;
+
+static std::vector<sim_event_t> events;
+static size_t next_event = 0;
+static uint64_t end_us = 0;
+static uint64_t next_wdt_us = 0; // true time of the next WDT interrupt
+
+// watch clock at the last WDT interrupt, against the true time
+static int64_t drift_us = 0;
+static uint64_t drift_at_us = 0;
+static bool time_set = false; // once, the watch starts in 2016
+static int64_t max_drift_us = 0;
+// drift rate of the report period, over the ticks the time was not set
+static int64_t period_drift_us = 0;
+static uint64_t period_span_us = 0;
+
+static double osc_error_ppm() {
+  return error_ppm + (temp_ppm * ((host_temp_mc / 1000.0) - 25)) + (vcc_ppm * ((host_vcc_mv / 1000.0) - 3));
+}
+
+// true length of a WDT tick, of the prescaler in WDTCR
+static uint64_t wdt_period_us() {
+  uint8_t ii = (WDTCR & 7) | ((WDTCR & _BV(WDP3)) ? 8 : 0);
+  return llround((15625ULL << ii) * (1 + (osc_error_ppm() / 1000000)));
+}
+
+static void update_sensors() {
+  double hours = host_time_us / 3600e6;
+  double clock_hours = fmod(hours + ((SIM_START_TIME % SECS_PER_DAY) / 3600.0), 24);
+  host_temp_mc = lround((temp_mean + (temp_swing * cos((clock_hours - 15) * M_PI / 12))) * 1000);
+  host_vcc_mv = lround(vcc_start + ((vcc_end - vcc_start) * host_time_us / end_us));
+}
+
+// watch time in microseconds, exact at a WDT interrupt
+static int64_t watch_us() {
+  return ((int64_t)sysTime * 1000000) + (((uint64_t)time_phase * 1000000) >> 24);
+}
+
+static int64_t true_us() {
+  return ((int64_t)SIM_START_TIME * 1000000) + host_time_us;
+}
+
+static void wdt_tick() {
+  host_time_us = next_wdt_us;
+  update_sensors();
+  WDT_vect();
+  next_wdt_us = host_time_us + wdt_period_us();
+  int64_t drift = watch_us() - true_us();
+  if (time_set && (llabs(drift - drift_us) < SIM_STEP_US)) {
+    period_drift_us += drift - drift_us;
+    period_span_us += host_time_us - drift_at_us;
+  }
+  drift_us = drift;
+  drift_at_us = host_time_us;
+  if (time_set && (llabs(drift_us) > llabs(max_drift_us))) max_drift_us = drift_us;
+}
+
+// the pin change interrupt fires when the ladder crosses the pin's logic threshold, true if it did
+static bool set_button_adc(uint16_t adc) {
+  bool changed = (digitalRead(BUTTONPIN) == HIGH) != (adc > 512);
+  host_button_adc = adc;
+  if (!changed || !(GIMSK & _BV(PCIE)) || !(PCMSK & _BV(PCINT3))) return false;
+  PCINT0_vect();
+  return true;
+}
+
+// sleep hook, run the button events and WDT ticks up to the next interrupt
+static void sim_sleep(uint8_t mode) {
+  uint64_t wake_us = next_wdt_us;
+  if ((mode != SLEEP_MODE_PWR_DOWN) && (host_time_us + SIM_IDLE_US < wake_us)) wake_us = host_time_us + SIM_IDLE_US;
+  while ((next_event < events.size()) && (events[next_event].us < wake_us) && (events[next_event].action == sim_button)) {
+    if (events[next_event].us > host_time_us) host_time_us = events[next_event].us;
+    if (set_button_adc(events[next_event++].adc)) return; // woken by the pin change, loop() looks
+  }
+  if (wake_us == next_wdt_us) {
+    wdt_tick();
+  } else {
+    host_time_us = wake_us;
+  }
+}
+
+// what a user does with the buttons and a good clock, in one go
+static void sync_time() {
+  int64_t watch = watch_us() + (host_time_us - drift_at_us); // the watch counts on since the last tick
+  int32_t seconds = llround((true_us() - watch) / 1e6);
+  if (seconds == 0) return; // right already, nothing to set
+  now(); // brings sysTime up to date, as the time adjust screen does
+  adjustTime(seconds);
+  time_changed = true;
+  finish_time_adjust();
+  time_set = true;
+}
+
+static void add_press(uint64_t us, uint16_t adc, uint32_t ms) {
+  sim_event_t down = {us, sim_button, adc};
+  sim_event_t up = {us + (ms * 1000ULL), sim_button, SIM_ADC_RELEASED};
+  events.push_back(down);
+  events.push_back(up);
+}
+
+static bool read_script(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    double seconds;
+    char name[16];
+    unsigned long ms = 0;
+    int n = sscanf(line, "%lf %15s %lu", &seconds, name, &ms);
+    if ((n < 2) || (line[0] == '#')) continue;
+    uint64_t us = llround(seconds * 1e6);
+    if (!strcmp(name, "sync")) {
+      sim_event_t sync = {us, sim_sync, 0};
+      events.push_back(sync);
+    } else if (n == 3) {
+      uint16_t adc = (!strcmp(name, "set")) ? SIM_ADC_SET : ((!strcmp(name, "up")) ? SIM_ADC_UP : SIM_ADC_DOWN);
+      add_press(us, adc, ms);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static bool read_pair(const char *arg, double &a, double &b) {
+  return sscanf(arg, "%lf:%lf", &a, &b) == 2;
+}
+
+int main(int argc, char *argv[]) {
+  const char *script = NULL;
+  bool ok = true;
+
+  for (int i = 1; ok && (i < argc); i++) {
+    if ((!strcmp(argv[i], "-d")) && (i + 1 < argc)) {
+      days = atof(argv[++i]);
+    } else if ((!strcmp(argv[i], "-e")) && (i + 1 < argc)) {
+      error_ppm = atof(argv[++i]);
+    } else if ((!strcmp(argv[i], "-k")) && (i + 1 < argc)) {
+      temp_ppm = atof(argv[++i]);
+    } else if ((!strcmp(argv[i], "-u")) && (i + 1 < argc)) {
+      vcc_ppm = atof(argv[++i]);
+    } else if ((!strcmp(argv[i], "-T")) && (i + 1 < argc)) {
+      ok = read_pair(argv[++i], temp_mean, temp_swing);
+    } else if ((!strcmp(argv[i], "-V")) && (i + 1 < argc)) {
+      ok = read_pair(argv[++i], vcc_start, vcc_end);
+    } else if ((!strcmp(argv[i], "-g")) && (i + 1 < argc)) {
+      glance_minutes = atof(argv[++i]);
+    } else if ((!strcmp(argv[i], "-s")) && (i + 1 < argc)) {
+      sync_hours = atof(argv[++i]);
+#ifdef WATCH_ALARMS
+    } else if ((!strcmp(argv[i], "-a")) && (i + 1 < argc)) {
+      ok = read_pair(argv[++i], alarm_hour, alarm_minute);
+#endif
+    } else if ((!strcmp(argv[i], "-p")) && (i + 1 < argc)) {
+      script = argv[++i];
+    } else if ((!strcmp(argv[i], "-r")) && (i + 1 < argc)) {
+      report_hours = atof(argv[++i]);
+    } else {
+      ok = false;
+    }
+  }
+  if (!ok || (days <= 0) || (report_hours <= 0)) {
+    fprintf(stderr, "usage: %s [-d days] [-e ppm] [-k ppm_per_C] [-u ppm_per_V] [-T mean_C:swing_C]\n"
+            "       [-V start_mV:end_mV] [-g glance_minutes] [-s sync_hours] [-a hour:minute]\n"
+            "       [-p script] [-r report_hours]\n", argv[0]);
+    return 2;
+  }
+  if (script && !read_script(script)) {
+    fprintf(stderr, "cannot read %s\n", script);
+    return 1;
+  }
+
+  // the user sets the time after power on, then every sync_hours, and glances every glance_minutes
+  end_us = llround(days * 86400e6);
+  sim_event_t first_sync = {2000000, sim_sync, 0}; // once the display is up
+  events.push_back(first_sync);
+  if (sync_hours > 0) {
+    for (uint64_t us = llround(sync_hours * 3600e6); us < end_us; us += llround(sync_hours * 3600e6)) {
+      sim_event_t sync = {us, sim_sync, 0};
+      events.push_back(sync);
+    }
+  }
+  if (glance_minutes > 0) {
+    for (uint64_t us = llround(glance_minutes * 60e6); us < end_us; us += llround(glance_minutes * 60e6)) {
+      add_press(us, SIM_ADC_SET, 200);
+    }
+  }
+  std::stable_sort(events.begin(), events.end());
+
+  host_sleep_hook = sim_sleep;
+  update_sensors();
+  setup();
+#ifdef WATCH_ALARMS
+  if (alarm_hour >= 0) alarm_set_daily(alarm_hour, alarm_minute);
+#endif
+  next_wdt_us = host_time_us + wdt_period_us();
+
+  printf("oscillator %+.0f ppm %+.0f ppm/C %+.0f ppm/V, %.1f +/- %.1f C, %.0f -> %.0f mV\n",
+         error_ppm, temp_ppm, vcc_ppm, temp_mean, temp_swing, vcc_start, vcc_end);
+  printf("%7s %9s %8s %9s %9s %6s %5s %8s %7s %5s %6s %5s\n", "hours", "drift s", "ppm", "tick us", "true us",
+         "wdt", "pin", "awake s", "eeprom", "uA", "C", "mV");
+
+  uint64_t report_us = llround(report_hours * 3600e6);
+  uint64_t next_report_us = report_us;
+  uint32_t report_wdt = 0, report_pin = 0, report_awake = 0, report_eeprom = 0;
+  while (host_time_us < end_us) {
+    while ((next_event < events.size()) && (events[next_event].us <= host_time_us)) {
+      if (events[next_event].action == sim_sync) {
+        sync_time();
+      } else {
+        set_button_adc(events[next_event].adc);
+      }
+      next_event++;
+    }
+    loop();
+
+    if ((host_time_us >= next_report_us) || (host_time_us >= end_us)) {
+      double ppm = period_span_us ? (period_drift_us * 1e6 / period_span_us) : 0;
+      printf("%7.1f %9.3f %8.0f %9lu %9.0f %6lu %5lu %8.1f %7lu %5lu %6.1f %5u\n",
+             host_time_us / 3600e6, drift_us / 1e6, ppm,
+             (unsigned long)get_wdt_microsecond_per_interrupt(), 1e6 * (1 + (osc_error_ppm() / 1000000)),
+             (unsigned long)(energy_counters.wdt_wakes - report_wdt), (unsigned long)(energy_counters.button_wakes - report_pin),
+             (energy_awake_ms() - report_awake) / 1000.0, (unsigned long)(host_eeprom_writes - report_eeprom),
+             (unsigned long)energy_average_ua(get_uptime(), oled.get_sent_bytes(), oled.get_sent_transactions()),
+             host_temp_mc / 1000.0, host_vcc_mv);
+      report_wdt = energy_counters.wdt_wakes;
+      report_pin = energy_counters.button_wakes;
+      report_awake = energy_awake_ms();
+      report_eeprom = host_eeprom_writes;
+      period_drift_us = 0;
+      period_span_us = 0;
+      next_report_us += report_us;
+    }
+  }
+
+  uint32_t worst = 0;
+  for (uint16_t i = 0; i < HOST_EEPROM_SIZE; i++) worst = std::max(worst, host_eeprom_cell_writes[i]);
+  printf("total: %.1f days, drift %.3f s at the end, %.3f s at most, %lu WDT and %lu pin wakes, %.1f s awake\n",
+         host_time_us / 86400e6, drift_us / 1e6, max_drift_us / 1e6,
+         (unsigned long)energy_counters.wdt_wakes, (unsigned long)energy_counters.button_wakes, energy_awake_ms() / 1000.0);
+  printf("total: %lu EEPROM bytes written, %lu at most to one cell, %lu frames, average %lu uA\n",
+         (unsigned long)host_eeprom_writes, (unsigned long)worst, (unsigned long)energy_counters.frames,
+         (unsigned long)energy_average_ua(get_uptime(), oled.get_sent_bytes(), oled.get_sent_transactions()));
+  if (alarm_hour >= 0) printf("total: %lu alarm(s) gone off\n", (unsigned long)energy_counters.alarms);
+  return 0;
+}
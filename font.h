@@ -1,48 +1,28 @@
+// generated by extras/host/fontc from extras/fonts/font_5x8.txt, do not edit
 #include <avr/pgmspace.h>
 
 #define FONT_WIDTH 5
-#define FONT_RANGE_START 32 // (space)
-#define FONT_RANGE_END 126 // '~'
+#define FONT_RANGE_START 45 // '-'
+#define FONT_RANGE_END 87 // 'W'
+#define FONT_MAP // code - FONT_RANGE_START to glyph index, 0xFF for none
 
-static const uint8_t font_bitmap[] PROGMEM = { // 95 ASCII characters
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5F, 0x00, 0x00, 0x00, 0x03, 
-  0x00, 0x03, 0x00, 0x14, 0x7F, 0x14, 0x7F, 0x14, 0x00, 0x4C, 0x7A, 0x4F, 
-  0x32, 0x00, 0x66, 0x16, 0x68, 0x66, 0x00, 0x38, 0x4F, 0x4D, 0x32, 0x00, 
-  0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x3E, 0x41, 0x00, 0x00, 0x00, 0x41, 
-  0x3E, 0x00, 0x00, 0x1C, 0x3E, 0x1C, 0x00, 0x00, 0x08, 0x3E, 0x08, 0x00, 
-  0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 
-  0x40, 0x00, 0x00, 0x00, 0x40, 0x30, 0x0C, 0x03, 0x00, 0x3E, 0x41, 0x41, 
-  0x3E, 0x00, 0x42, 0x7F, 0x40, 0x00, 0x00, 0x62, 0x51, 0x49, 0x46, 0x00, 
-  0x22, 0x49, 0x49, 0x36, 0x00, 0x38, 0x26, 0x7F, 0x20, 0x00, 0x4F, 0x49, 
-  0x49, 0x31, 0x00, 0x3E, 0x49, 0x49, 0x32, 0x00, 0x03, 0x71, 0x09, 0x07, 
-  0x00, 0x36, 0x49, 0x49, 0x36, 0x00, 0x26, 0x49, 0x49, 0x3E, 0x00, 0x00, 
-  0x24, 0x00, 0x00, 0x00, 0x40, 0x24, 0x00, 0x00, 0x00, 0x08, 0x14, 0x22, 
-  0x41, 0x00, 0x14, 0x14, 0x14, 0x14, 0x00, 0x41, 0x22, 0x14, 0x08, 0x00, 
-  0x02, 0x51, 0x09, 0x06, 0x00, 0x0E, 0x71, 0x49, 0x7E, 0x00, 0x7E, 0x11, 
-  0x11, 0x7E, 0x00, 0x7F, 0x49, 0x49, 0x36, 0x00, 0x3E, 0x41, 0x41, 0x22, 
-  0x00, 0x7F, 0x41, 0x41, 0x3E, 0x00, 0x7F, 0x49, 0x49, 0x41, 0x00, 0x7F, 
-  0x09, 0x09, 0x01, 0x00, 0x3E, 0x41, 0x49, 0x3A, 0x00, 0x7F, 0x08, 0x08, 
-  0x7F, 0x00, 0x41, 0x7F, 0x41, 0x00, 0x00, 0x30, 0x40, 0x40, 0x3F, 0x00, 
-  0x7F, 0x08, 0x14, 0x63, 0x00, 0x7F, 0x40, 0x40, 0x40, 0x00, 0x7F, 0x06, 
-  0x06, 0x7F, 0x00, 0x7F, 0x06, 0x18, 0x7F, 0x00, 0x7F, 0x41, 0x41, 0x7F, 
-  0x00, 0x7F, 0x09, 0x09, 0x06, 0x00, 0x3E, 0x51, 0x61, 0x7E, 0x00, 0x7F, 
-  0x19, 0x29, 0x46, 0x00, 0x26, 0x49, 0x49, 0x32, 0x00, 0x01, 0x7F, 0x01, 
-  0x01, 0x00, 0x3F, 0x40, 0x40, 0x3F, 0x00, 0x0F, 0x70, 0x70, 0x0F, 0x00, 
-  0x7F, 0x30, 0x30, 0x7F, 0x00, 0x63, 0x1C, 0x1C, 0x63, 0x03, 0x04, 0x78, 
-  0x04, 0x03, 0x00, 0x61, 0x59, 0x4D, 0x43, 0x00, 0x00, 0x7F, 0x41, 0x00, 
-  0x03, 0x0C, 0x30, 0x40, 0x00, 0x00, 0x00, 0x41, 0x7F, 0x00, 0x00, 0x02, 
-  0x01, 0x02, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x03, 0x00, 
-  0x00, 0x00, 0x20, 0x58, 0x58, 0x78, 0x00, 0x7F, 0x48, 0x48, 0x30, 0x00, 
-  0x30, 0x48, 0x48, 0x48, 0x00, 0x30, 0x48, 0x48, 0x7F, 0x00, 0x30, 0x58, 
-  0x58, 0x10, 0x00, 0x08, 0x7C, 0x0A, 0x08, 0x00, 0x10, 0xA8, 0xA8, 0x78, 
-  0x00, 0x7F, 0x08, 0x78, 0x00, 0x00, 0x00, 0x74, 0x00, 0x00, 0x00, 0x80, 
-  0x80, 0x74, 0x00, 0x00, 0x7F, 0x10, 0x28, 0x48, 0x00, 0x40, 0x7F, 0x40, 
-  0x00, 0x00, 0x78, 0x08, 0x78, 0x78, 0x00, 0x78, 0x08, 0x08, 0x70, 0x00, 
-  0x30, 0x48, 0x48, 0x30, 0x00, 0xF8, 0x48, 0x48, 0x30, 0x00, 0x30, 0x48, 
-  0x48, 0xF8, 0x00, 0x78, 0x10, 0x08, 0x08, 0x00, 0x50, 0x58, 0x68, 0x28, 
-  0x00, 0x08, 0x7C, 0x48, 0x00, 0x00, 0x38, 0x40, 0x40, 0x78, 0x00, 0x18, 
-  0x60, 0x60, 0x18, 0x18, 0x60, 0x38, 0x60, 0x18, 0x00, 0x48, 0x30, 0x30, 
-  0x48, 0x00, 0x18, 0xA0, 0xA0, 0x78, 0x00, 0x48, 0x68, 0x58, 0x48, 0x00, 
-  0x08, 0x77, 0x41, 0x00, 0x00, 0x00, 0x7F, 0x00, 0x00, 0x00, 0x41, 0x77, 
-  0x08, 0x00, 0x00, 0x02, 0x01, 0x02, 0x01, };
-
+static const uint8_t font_map[] PROGMEM = {
+  0x00, 0xFF, 0xFF, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 
+  0x0A, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x0B, 0x0C, 0x0D, 0x0E, 
+  0x0F, 0x10, 0xFF, 0xFF, 0x11, 0xFF, 0x12, 0xFF, 0x13, 0xFF, 0xFF, 0x14, 
+  0xFF, 0xFF, 0x15, 0x16, 0xFF, 0x17, 0x18, 
+  };
+
+static const uint8_t font_bitmap[] PROGMEM = { // 25 characters "-0123456789ABCDEFIKMPSTVW"
+  0x00, 0x08, 0x08, 0x08, 0x08, 0x00, 0x3E, 0x41, 0x41, 0x3E, 0x00, 0x42, 
+  0x7F, 0x40, 0x00, 0x00, 0x62, 0x51, 0x49, 0x46, 0x00, 0x22, 0x49, 0x49, 
+  0x36, 0x00, 0x38, 0x26, 0x7F, 0x20, 0x00, 0x4F, 0x49, 0x49, 0x31, 0x00, 
+  0x3E, 0x49, 0x49, 0x32, 0x00, 0x03, 0x71, 0x09, 0x07, 0x00, 0x36, 0x49, 
+  0x49, 0x36, 0x00, 0x26, 0x49, 0x49, 0x3E, 0x00, 0x7E, 0x11, 0x11, 0x7E, 
+  0x00, 0x7F, 0x49, 0x49, 0x36, 0x00, 0x3E, 0x41, 0x41, 0x22, 0x00, 0x7F, 
+  0x41, 0x41, 0x3E, 0x00, 0x7F, 0x49, 0x49, 0x41, 0x00, 0x7F, 0x09, 0x09, 
+  0x01, 0x00, 0x41, 0x7F, 0x41, 0x00, 0x00, 0x7F, 0x08, 0x14, 0x63, 0x00, 
+  0x7F, 0x06, 0x06, 0x7F, 0x00, 0x7F, 0x09, 0x09, 0x06, 0x00, 0x26, 0x49, 
+  0x49, 0x32, 0x00, 0x01, 0x7F, 0x01, 0x01, 0x00, 0x0F, 0x70, 0x70, 0x0F, 
+  0x00, 0x7F, 0x30, 0x30, 0x7F, 
+  };
@@ -1,10 +1,11 @@
+// generated by extras/host/fontc from extras/fonts/font_9x16.txt, do not edit
 #include <avr/pgmspace.h>
 
 #define FONT_2X_WIDTH 9
 #define FONT_2X_RANGE_START 48 // '0'
 #define FONT_2X_RANGE_END 57 // '9'
 
-static const uint8_t font_2x_bitmap[] PROGMEM = { // digit 0-9
+static const uint8_t font_2x_bitmap[] PROGMEM = { // 10 characters "0123456789"
   0x00, 0x00, 0xE0, 0x1F, 0xF8, 0x3F, 0x3C, 0x20, 0x06, 0x20, 0x02, 0x38, 
   0xC2, 0x1F, 0xFC, 0x07, 0xF8, 0x00, 0x00, 0x00, 0x08, 0x20, 0x08, 0x20, 
   0x04, 0x3C, 0xE4, 0x3F, 0xFC, 0x2F, 0x3E, 0x20, 0x00, 0x00, 0x00, 0x00, 
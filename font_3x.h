@@ -1,44 +1,35 @@
+// generated by extras/host/fontc from extras/fonts/font_14x24.txt, do not edit
 #include <avr/pgmspace.h>
 
 #define FONT_3X_WIDTH 14
 #define FONT_3X_RANGE_START 48 // '0'
 #define FONT_3X_RANGE_END 57 // '9'
+#define FONT_3X_RLE // run length glyphs, see font_rle.h
 
-static const uint8_t font_3x_bitmap[] PROGMEM = { // digit 0-9
-  0xE0, 0x7F, 0x00, 0xF0, 0xFF, 0x00, 0xFC, 0xFF, 0x03, 0xFC, 0xFF, 0x03, 
-  0x0E, 0x00, 0x07, 0x06, 0x00, 0x06, 0x02, 0x00, 0x04, 0x06, 0x00, 0x06, 
-  0xFC, 0xFF, 0x03, 0xFC, 0xFF, 0x03, 0xF8, 0xFF, 0x01, 0xE0, 0x7F, 0x00, 
-  0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x04, 
-  0x08, 0x00, 0x04, 0x08, 0x00, 0x04, 0xFC, 0xFF, 0x07, 0xFC, 0xFF, 0x07, 
-  0xFC, 0xFF, 0x07, 0xFE, 0xFF, 0x07, 0x00, 0x00, 0x06, 0x00, 0x00, 0x04, 
-  0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-  0x00, 0x00, 0x04, 0xF0, 0x00, 0x06, 0xF8, 0x81, 0x07, 0xFC, 0xC1, 0x07, 
-  0xE4, 0xE1, 0x07, 0xC6, 0xB0, 0x07, 0x02, 0xB8, 0x07, 0x06, 0x9E, 0x07, 
-  0x0E, 0x8F, 0x07, 0xFE, 0x8F, 0x07, 0xFC, 0x87, 0x07, 0xF8, 0xC3, 0x07, 
-  0xF0, 0xF0, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0xE0, 0x01, 
-  0x78, 0xF0, 0x03, 0x7C, 0xF0, 0x03, 0x7E, 0xE2, 0x06, 0x02, 0x02, 0x04, 
-  0x02, 0x02, 0x04, 0x06, 0x06, 0x06, 0x8E, 0x0F, 0x07, 0xFE, 0xFF, 0x07, 
-  0xFC, 0xFD, 0x03, 0xF8, 0xFC, 0x03, 0x70, 0xF8, 0x00, 0x00, 0x00, 0x00, 
-  0x00, 0x20, 0x00, 0x00, 0x78, 0x00, 0x00, 0x7C, 0x00, 0x00, 0x66, 0x00, 
-  0x00, 0x63, 0x00, 0xC0, 0x61, 0x04, 0x60, 0x60, 0x04, 0xF0, 0xFF, 0x07, 
-  0xFC, 0xFF, 0x07, 0xFE, 0xFF, 0x07, 0xFE, 0xFF, 0x07, 0x00, 0x60, 0x06, 
-  0x00, 0x60, 0x04, 0x00, 0x20, 0x00, 0x00, 0xE0, 0x01, 0xF8, 0xF7, 0x03, 
-  0xFE, 0xF3, 0x03, 0x3C, 0xE1, 0x06, 0xBC, 0x01, 0x04, 0xBC, 0x01, 0x06, 
-  0xBC, 0x01, 0x06, 0xBC, 0x83, 0x07, 0x9C, 0xFF, 0x03, 0x1C, 0xFF, 0x03, 
-  0x0E, 0xFE, 0x01, 0x02, 0xFC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-  0xC0, 0x7F, 0x00, 0xF0, 0xFF, 0x01, 0xF8, 0xFF, 0x03, 0xFC, 0xFF, 0x03, 
-  0x3C, 0x0E, 0x07, 0x06, 0x02, 0x04, 0x06, 0x03, 0x04, 0x02, 0x07, 0x06, 
-  0x3E, 0xFF, 0x07, 0x7E, 0xFF, 0x03, 0x7C, 0xFE, 0x03, 0x38, 0xFC, 0x01, 
-  0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x00, 0x00, 0xFE, 0x00, 0x00, 
-  0x1E, 0x00, 0x00, 0x1E, 0x00, 0x00, 0x1E, 0xC0, 0x03, 0x1E, 0xF0, 0x07, 
-  0x1E, 0xFC, 0x07, 0x1E, 0xFE, 0x03, 0x9E, 0x7F, 0x00, 0xDE, 0x01, 0x00, 
-  0x7E, 0x00, 0x00, 0x1E, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 
-  0xE0, 0xF0, 0x01, 0xF8, 0xFB, 0x03, 0xFC, 0xFB, 0x03, 0xFC, 0x1F, 0x07, 
-  0x86, 0x0F, 0x06, 0x82, 0x0F, 0x04, 0x82, 0x0F, 0x04, 0x06, 0x0F, 0x06, 
-  0x8E, 0x1F, 0x06, 0xFC, 0xFF, 0x03, 0xFC, 0xFE, 0x03, 0x78, 0xFC, 0x00, 
-  0x00, 0x70, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xC3, 0x01, 0xF8, 0xC7, 0x03, 
-  0xFC, 0xEF, 0x07, 0xFE, 0xCF, 0x07, 0x06, 0x8E, 0x04, 0x02, 0x0C, 0x04, 
-  0x02, 0x0C, 0x06, 0x06, 0x86, 0x03, 0xFC, 0xFF, 0x03, 0xFC, 0xFF, 0x01, 
-  0xF8, 0xFF, 0x00, 0xF0, 0x7F, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 
+static const uint8_t font_3x_bitmap[] PROGMEM = { // 10 characters "0123456789"
+  0x17, 0xA5, 0xCD, 0xFA, 0x10, 0xF8, 0x10, 0x37, 0x3C, 0x26, 0x2E, 0x16, 
+  0x0F, 0x11, 0x26, 0x2E, 0xF7, 0x10, 0xF8, 0x10, 0xE9, 0xAC, 0x0F, 0x42, 
+  0x15, 0x0F, 0x1C, 0x1E, 0x18, 0x1E, 0x18, 0x1E, 0xF7, 0x20, 0xF7, 0x20, 
+  0xF7, 0x20, 0xF6, 0x30, 0x0F, 0x27, 0x0F, 0x18, 0x0F, 0x18, 0x20, 0x0F, 
+  0x13, 0x49, 0x29, 0x68, 0x46, 0x77, 0x55, 0x17, 0x42, 0x64, 0x26, 0x23, 
+  0x24, 0x41, 0x16, 0x39, 0x41, 0x26, 0x46, 0x42, 0x36, 0x44, 0x43, 0xB6, 
+  0x43, 0x97, 0x44, 0x78, 0x54, 0x49, 0x74, 0x1F, 0x0F, 0x2D, 0x47, 0x4A, 
+  0x65, 0x58, 0x65, 0x67, 0x12, 0x33, 0x21, 0x16, 0x17, 0x18, 0x16, 0x17, 
+  0x18, 0x26, 0x26, 0x26, 0x36, 0x53, 0x34, 0xF6, 0x30, 0x77, 0x81, 0x59, 
+  0x82, 0x3A, 0x54, 0x20, 0x1D, 0x0F, 0x46, 0x0F, 0x54, 0x0F, 0x23, 0x22, 
+  0x0F, 0x22, 0x23, 0x3F, 0x24, 0x13, 0x2A, 0x26, 0x13, 0xF9, 0xF7, 0x20, 
+  0xF6, 0x30, 0xF6, 0x30, 0x0F, 0x23, 0x22, 0x0F, 0x23, 0x13, 0x0F, 0x13, 
+  0x1D, 0x4D, 0x8A, 0x61, 0x97, 0x62, 0x48, 0x12, 0x34, 0x21, 0x47, 0x21, 
+  0x19, 0x47, 0x21, 0x28, 0x47, 0x21, 0x28, 0x47, 0x31, 0x45, 0x37, 0xB2, 
+  0x38, 0xA3, 0x37, 0x85, 0x18, 0x68, 0x1B, 0x96, 0xDD, 0xFA, 0xF8, 0x10, 
+  0x48, 0x33, 0x34, 0x26, 0x16, 0x18, 0x26, 0x25, 0x18, 0x16, 0x36, 0x26, 
+  0x56, 0xB2, 0x66, 0xA1, 0x58, 0x92, 0x39, 0x74, 0x0F, 0x24, 0x1A, 0x35, 
+  0x0F, 0x72, 0x0F, 0x42, 0x0F, 0x45, 0x0F, 0x45, 0x49, 0x47, 0x77, 0x46, 
+  0x95, 0x46, 0x94, 0x47, 0x82, 0x4A, 0x31, 0x0F, 0x61, 0x0F, 0x43, 0x0F, 
+  0x15, 0x1F, 0x35, 0x54, 0x7A, 0x71, 0x88, 0x71, 0xB8, 0x33, 0x26, 0x54, 
+  0x25, 0x16, 0x55, 0x16, 0x16, 0x55, 0x16, 0x26, 0x45, 0x25, 0x36, 0x63, 
+  0x24, 0xF7, 0x10, 0x68, 0x91, 0x49, 0x63, 0x0F, 0x35, 0x1C, 0x64, 0x34, 
+  0x8A, 0x43, 0xA8, 0x61, 0xB6, 0x52, 0x26, 0x36, 0x13, 0x12, 0x16, 0x28, 
+  0x16, 0x16, 0x28, 0x25, 0x26, 0x26, 0x34, 0xF8, 0x10, 0xF8, 0xDA, 0xBC, 
+  0x0F, 0x32, 
   };
-
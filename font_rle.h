@@ -0,0 +1,61 @@
+/*
+ * Run length glyphs, written by extras/host/fontc -r
+ * A glyph is its length in bytes followed by 4 bit run lengths, low nibble first,
+ * of alternating dark and lit pixels starting with dark. The pixels run in the same
+ * column major, page packed order as a plain font, bit 0 first; a 0 run only switches
+ * colour, to extend a run over 15 pixels. Pixels after the last run are dark.
+ * Bytes are decoded one at a time as they are sent, no RAM buffer.
+ */
+#ifndef _font_rle_h
+#define _font_rle_h
+
+#include <avr/pgmspace.h>
+
+typedef struct {
+  const uint8_t *src; // next packed byte
+  uint8_t left;       // packed bytes left in the glyph
+  uint8_t packed;     // nibbles not used yet
+  uint8_t nibbles;    // count of them
+  uint8_t run;        // pixels left in the current run
+  uint8_t lit;        // 0xFF while the current run is lit
+} rle_glyph_t;
+
+static inline void rle_glyph_start(rle_glyph_t &rle, const uint8_t *bitmap, uint8_t glyph) {
+  while (glyph--) bitmap += pgm_read_byte_near(bitmap) + 1; // skip the glyphs before
+  rle.left = pgm_read_byte_near(bitmap);
+  rle.src = bitmap + 1;
+  rle.nibbles = 0;
+  rle.run = 0;
+  rle.lit = 0xFF; // switched to dark by the first run
+}
+
+static inline uint8_t rle_glyph_next(rle_glyph_t &rle) {
+  uint8_t data = 0;
+  uint8_t bit = 0;
+  while (bit < 8) {
+    while (rle.run == 0) {
+      if (rle.nibbles == 0) {
+        if (rle.left == 0) { // end of glyph, dark up to the end
+          rle.run = 0xFF;
+          rle.lit = 0;
+          break;
+        }
+        rle.packed = pgm_read_byte_near(rle.src++);
+        rle.nibbles = 2;
+        rle.left--;
+      }
+      rle.run = rle.packed & 0x0F;
+      rle.packed >>= 4;
+      rle.nibbles--;
+      rle.lit = ~rle.lit;
+    }
+    uint8_t n = 8 - bit;
+    if (rle.run < n) n = rle.run;
+    if (rle.lit) data |= (uint8_t)(0xFF >> (8 - n)) << bit;
+    bit += n;
+    rle.run -= n;
+  }
+  return data;
+}
+
+#endif
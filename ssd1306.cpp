@@ -4,23 +4,41 @@
  * SSD1306 data sheet: https://www.adafruit.com/datasheets/SSD1306.pdf
  */
 #include <avr/pgmspace.h>
-#include <TinyWireM.h>
+#include <avr/sleep.h>
 #include "ssd1306.h"
+#include "font_rle.h"
+
+#ifdef SSD1306_TINYWIREM
+// bytes are copied into an 18 bytes buffer, a long transaction is split where it fills up
+#include <TinyWireM.h>
+#define i2c_begin() TinyWireM.begin()
+#define i2c_start(addr) TinyWireM.beginTransmission(addr)
+#define i2c_write(data) TinyWireM.write(data)
+#define i2c_stop() TinyWireM.endTransmission()
+#else
+// bytes go out on the bus as they are written, a transaction has no length limit
+#include "USI_I2C.h"
+#define i2c_begin() usi_i2c_begin()
+#define i2c_start(addr) usi_i2c_start(addr)
+#define i2c_write(data) usi_i2c_write(data)
+#define i2c_stop() usi_i2c_stop()
+#endif
 
 /*
  * Software Configuration, data sheet page 64
  */
 
 static const uint8_t ssd1306_configuration[] PROGMEM = {
-
-#ifdef SCREEN_128X64
-  0xA8, 0x3F,   // Set MUX Ratio, 0F-3F
-#else // SCREEN_128X32 / SCREED_64X32
-  0xA8, 0x1F,   // Set MUX Ratio, 0F-3F
-#endif
-
+#ifndef SSD1306_POWER_PROFILES // SSD1306_PROFILE_NORMAL, else send_power_profile() sends it
+  0x81, 0x01,   // Set Contrast Control
+  0xD9, 0x22,   // Set Pre-charge Period
+  0xDB, 0x20,   // Set VCOMH Deselect Level
+  0xD5, 0x80,   // Set Display Clock Divide Ratio / Oscillator Frequency
+  0xA8, (PAGES * 8) - 1, // Set MUX Ratio, all rows
   0xD3, 0x00,   // Set Display Offset
+#endif
   0x40,         // Set Display Start line
+  0x20, 0x01,   // Set Memory Addressing Mode, vertical
   0xA1,         // Set Segment re-map, mirror, A0/A1
   0xC8,         // Set COM Output Scan Direction, flip, C0/C8
 
@@ -30,205 +48,1008 @@ static const uint8_t ssd1306_configuration[] PROGMEM = {
   0xDA, 0x12,   // Set Com Pins hardware configuration, Alternative
 #endif
 
-  0x81, 0x01,   // Set Contrast Control, 01-FF
   0xA4,         // Disable Entire Display On, 0xA4=Output follows RAM content; 0xA5,Output ignores RAM content
   0xA6,         // Set Display Mode. A6=Normal; A7=Inverse
-  0xD5, 0x80,   // Set Osc Frequency
   0x8D, 0x14,   // Enable charge pump regulator
   0xAF          // Display ON in normal mode
 };
 
-SSD1306::SSD1306(void) {}
+#ifdef SSD1306_POWER_PROFILES
+/*
+ * Power profiles, applied in one command transaction. Contrast, pre-charge and
+ * VCOMH set the pixel current, the clock the refresh rate, fewer rows (MUX) a
+ * lower duty; the offset picks the GDDRAM rows a short MUX shows.
+ * Currents are unmeasured estimates of the panel with the watch face lit, put
+ * measured values here. GLANCE (MUX 16, offset 16, with the alternative COM
+ * pins configuration of 0xDA 0x12) is not verified on a panel.
+ */
+typedef struct {
+  uint8_t contrast;    // 0x81, 01-FF
+  uint8_t precharge;   // 0xD9, phase 2 high nibble, phase 1 low nibble, in DCLKs
+  uint8_t vcomh;       // 0xDB, 0x00 0.65 Vcc, 0x20 0.77 Vcc, 0x30 0.83 Vcc
+  uint8_t clock;       // 0xD5, oscillator high nibble, divide ratio - 1 low nibble
+  uint8_t rows;        // 0xA8 MUX ratio + 1, 0 for all rows of the panel
+  uint8_t offset;      // 0xD3, GDDRAM row shown on the first row
+  uint16_t current_ua; // estimated panel current, not measured
+} ssd1306_power_profile_t;
+
+static const ssd1306_power_profile_t ssd1306_power_profiles[SSD1306_PROFILE_COUNT] PROGMEM = {
+  {0xCF, 0xF1, 0x30, 0x80, 0, 0, 1500},   // SSD1306_PROFILE_BRIGHT, outdoor
+  {0x01, 0x22, 0x20, 0x80, 0, 0, 400},    // SSD1306_PROFILE_NORMAL, reset values but contrast
+  {0x00, 0x11, 0x00, 0x40, 0, 0, 250},    // SSD1306_PROFILE_DIM, low battery, shortest pre-charge, slower refresh
+  {0x00, 0x11, 0x00, 0x40, 16, 16, 130},  // SSD1306_PROFILE_GLANCE, rows 16 - 31 only, the large time
+};
+
+static uint8_t power_profile = SSD1306_PROFILE_NORMAL;
+#endif
+
+#ifdef SSD1306_STATS
+// I2C traffic statistic, address and control bytes included
+static uint32_t sent_bytes = 0;
+static uint32_t skipped_bytes = 0;
+static uint32_t sent_transactions = 0;
+#define COUNT_SENT(bytes) (sent_bytes += (bytes))
+#define COUNT_SKIPPED(bytes) (skipped_bytes += (bytes))
+#define COUNT_TRANSACTION() (sent_transactions++)
+#else
+#define COUNT_SENT(bytes) ((void)0)
+#define COUNT_SKIPPED(bytes) ((void)0)
+#define COUNT_TRANSACTION() ((void)0)
+#endif
+// bytes saved by a skipped cell besides its data: set_area transaction (address + control + 6 commands)
+// and data transaction header (address + control)
+#define CELL_OVERHEAD_BYTES 10
+
+// addressing window state, a run of glyphs continue in the same window by GDDRAM auto-increment
+static bool data_started = false; // data transaction kept open between glyphs, closed by flush()
+static bool window_valid = false;
+static uint8_t window_page = 0;
+static uint8_t window_height = 0;
+static uint8_t window_col_end = 0;
+static uint8_t window_next_col = 0; // column the GDDRAM pointer points to
+
+#if SSD1306_ASYNC_SEGMENTS > 0
+/*
+ * Asynchronous transfers: the send functions queue segments and return, and the
+ * USI clocks them out by interrupt. The USI has no SCL generator of its own, so
+ * ISR(TIMER0_COMPB_vect) strobes one SCL edge per Timer0 tick, next to the
+ * millis() overflow of the Arduino core, and the USI 4-bit counter raises
+ * ISR(USI_OVF_vect) at the end of each byte and acknowledge, which loads the next
+ * byte or moves SDA for START and STOP. Neither waits, the CPU idles between edges.
+ * A segment is up to 4 bytes inline (commands), or a reference: PROGMEM glyph,
+ * run length glyph, RAM bytes or a repeated byte. The one being built is queued when the
+ * next one starts, so the pump never reads a segment still growing.
+ */
+#define SEG_SOURCE 0x07
+#define SEG_INLINE 0x00
+#define SEG_PGM 0x01
+#define SEG_RLE 0x02
+#define SEG_REPEAT 0x03 // bytes[0] len times
+#define SEG_RAM 0x04 // must stay unchanged until sent
+#define SEG_STOP 0x10 // STOP after the bytes
+#define SEG_START 0x20 // START, address and control byte before the bytes
+#define SEG_DATA 0x40 // the control byte, commands if clear
+#define SEG_INLINE_SIZE 4
+
+typedef struct {
+  uint8_t kind;
+  uint8_t len;
+  union {
+    uint8_t bytes[SEG_INLINE_SIZE];
+    struct {
+      const uint8_t *src;
+      uint8_t invert;
+      uint8_t glyph;
+    } ref;
+  };
+} ssd1306_segment_t;
+
+static ssd1306_segment_t segments[SSD1306_ASYNC_SEGMENTS];
+static volatile uint8_t segment_head = 0;
+static volatile uint8_t segment_count = 0;
+static ssd1306_segment_t stage; // being built
+static bool stage_open = false;
+
+// pump state of the head segment
+#define PUMP_CONTROL 0 // control byte next, after the address
+#define PUMP_BYTES 1
+static uint8_t pump_step = PUMP_BYTES;
+static uint8_t pump_done = 0;
+static rle_glyph_t pump_rle;
+
+// bus state, what the next SCL edge or counter overflow does
+#define PUMP_IDLE 0 // STOP sent, Timer0 compare off
+#define PUMP_START 1 // SCL high, the next tick drops SDA
+#define PUMP_ADDRESS 2 // START sent, the address byte at SCL low
+#define PUMP_BYTE 3 // 8 bits shifting out
+#define PUMP_ACK 4 // SDA released for the acknowledge bit
+#define PUMP_STOP 5 // SDA low, SDA rises at SCL high
+#define PUMP_PAUSE 6 // in a transaction, SCL held low until the next segment is queued
+static volatile uint8_t pump_bus = PUMP_IDLE;
+
+// USISR, clear the start and overflow flags and count edges up to the next overflow;
+// the start flag holds SCL low until it is cleared, our own START sets it too
+#define USI_EDGES(n) (_BV(USISIF) | _BV(USIOIF) | (16 - (n)))
+#define PUMP_USICR (USI_I2C_USICR | _BV(USIOIE))
+#define PUMP_STROBE (USI_I2C_STROBE | _BV(USIOIE))
+
+// idle until at most most segments are queued, the pump interrupts wake the CPU
+static void wait_segments(uint8_t most) {
+  cli();
+  while (segment_count > most) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sei(); // the instruction after sei runs before any interrupt, a wake up is not missed
+    sleep_cpu();
+    sleep_disable();
+    cli();
+  }
+  sei();
+}
+
+static void pump_clock(bool on) {
+  if (on) {
+    OCR0B = TCNT0 + SSD1306_ASYNC_EDGE_TICKS;
+    TIFR = _BV(OCF0B);
+    TIMSK |= _BV(OCIE0B);
+  } else {
+    TIMSK &= ~_BV(OCIE0B);
+  }
+}
+
+static void pump_byte(uint8_t data) {
+  USIDR = data;
+  USISR = USI_EDGES(16);
+  pump_bus = PUMP_BYTE;
+}
+
+// the head segment from its first byte
+static void pump_begin(void) {
+  const ssd1306_segment_t *seg = &segments[segment_head];
+  pump_done = 0;
+  if ((seg->kind & SEG_SOURCE) == SEG_RLE) rle_glyph_start(pump_rle, seg->ref.src, seg->ref.glyph);
+  pump_step = (seg->kind & SEG_START) ? PUMP_CONTROL : PUMP_BYTES;
+}
+
+static uint8_t segment_byte(const ssd1306_segment_t *seg) {
+  switch (seg->kind & SEG_SOURCE) {
+    case SEG_INLINE:
+      return seg->bytes[pump_done];
+    case SEG_PGM:
+      return pgm_read_byte_near(seg->ref.src + pump_done) ^ seg->ref.invert;
+    case SEG_RLE:
+      return rle_glyph_next(pump_rle) ^ seg->ref.invert;
+    case SEG_RAM:
+      return seg->ref.src[pump_done];
+    default: // SEG_REPEAT
+      return seg->bytes[0];
+  }
+}
+
+// SCL low inside a transaction: the next byte, STOP, or pause for the next segment
+static void pump_next(void) {
+  const ssd1306_segment_t *seg = &segments[segment_head];
+  while (true) {
+    if (pump_step == PUMP_CONTROL) {
+      pump_step = PUMP_BYTES;
+      pump_byte(seg->kind & SEG_DATA);
+      return;
+    }
+    if (pump_done < seg->len) {
+      pump_byte(segment_byte(seg));
+      pump_done++;
+      return;
+    }
+    if (seg->kind & SEG_STOP) { // the segment ends at STOP
+      PORTB &= ~_BV(USI_I2C_SDA);
+      USISR = USI_EDGES(1);
+      pump_bus = PUMP_STOP;
+      return;
+    }
+    segment_head = (segment_head + 1) % SSD1306_ASYNC_SEGMENTS;
+    if (--segment_count == 0) { // the rest is still being drawn
+      pump_clock(false);
+      USISR = _BV(USISIF) | _BV(USIOIF);
+      pump_bus = PUMP_PAUSE;
+      return;
+    }
+    pump_begin();
+    seg = &segments[segment_head];
+  }
+}
+
+static void queue_stage(void) {
+  if (!stage_open) return;
+  wait_segments(SSD1306_ASYNC_SEGMENTS - 1);
+  cli();
+  segments[(segment_head + segment_count) % SSD1306_ASYNC_SEGMENTS] = stage;
+  if (segment_count++ == 0) { // pump stopped, start it
+    pump_begin();
+    if (pump_bus == PUMP_PAUSE) {
+      pump_next(); // SCL is low, the byte goes out at the next edges
+    } else {
+      pump_bus = PUMP_START;
+    }
+    if (pump_bus != PUMP_PAUSE) pump_clock(true); // an empty segment keeps the pause
+  }
+  sei();
+  stage_open = false;
+}
+
+static void stage_start(uint8_t control) {
+  queue_stage();
+  stage.kind = SEG_START | control | SEG_INLINE;
+  stage.len = 0;
+  stage_open = true;
+}
+
+static void stage_byte(uint8_t data) {
+  if ((!stage_open) || ((stage.kind & SEG_SOURCE) != SEG_INLINE) || (stage.len >= SEG_INLINE_SIZE)) {
+    queue_stage();
+    stage.kind = SEG_INLINE;
+    stage.len = 0;
+    stage_open = true;
+  }
+  stage.bytes[stage.len++] = data;
+}
+
+static void stage_ref(uint8_t source, const uint8_t *src, uint8_t len, uint8_t invert, uint8_t glyph) {
+  if (stage_open && (stage.kind & SEG_START) && (stage.len == 0)) { // takes over the START of an empty segment
+    stage.kind = (stage.kind & ~SEG_SOURCE) | source;
+  } else {
+    queue_stage();
+    stage.kind = source;
+    stage_open = true;
+  }
+  stage.len = len;
+  stage.ref.src = src;
+  stage.ref.invert = invert;
+  stage.ref.glyph = glyph;
+}
+
+static void stage_stop(void) {
+  if (!stage_open) {
+    stage.kind = SEG_INLINE;
+    stage.len = 0;
+    stage_open = true;
+  }
+  stage.kind |= SEG_STOP;
+  queue_stage();
+}
+
+// Timer0 compare, one SCL edge per tick while the pump runs
+ISR(TIMER0_COMPB_vect) {
+  OCR0B = TCNT0 + SSD1306_ASYNC_EDGE_TICKS;
+  if (pump_bus == PUMP_START) { // the bus was free for a tick
+    PORTB &= ~_BV(USI_I2C_SDA); // START, SDA falls while SCL is high
+    USISR = USI_EDGES(1);
+    pump_bus = PUMP_ADDRESS;
+  } else {
+    USICR = PUMP_STROBE;
+  }
+}
+
+// USI counter overflow, SCL low after a byte or an acknowledge, high after the STOP edge
+ISR(USI_OVF_vect) {
+  switch (pump_bus) {
+    case PUMP_ADDRESS:
+      USIDR = SSD1306_I2C_ADDR << 1; // write direction
+      PORTB |= _BV(USI_I2C_SDA); // USIDR drives SDA from here
+      USISR = USI_EDGES(16);
+      pump_bus = PUMP_BYTE;
+      break;
+    case PUMP_BYTE: // the slave pulls SDA low to acknowledge, not checked
+      USIDR = 0xFF;
+      DDRB &= ~_BV(USI_I2C_SDA);
+      USISR = USI_EDGES(2);
+      pump_bus = PUMP_ACK;
+      break;
+    case PUMP_ACK: // USIDR released SDA, for a STOP
+      DDRB |= _BV(USI_I2C_SDA);
+      pump_next();
+      break;
+    case PUMP_STOP:
+      PORTB |= _BV(USI_I2C_SDA); // STOP, SDA rises while SCL is high
+      USISR = _BV(USISIF) | _BV(USIOIF);
+      segment_head = (segment_head + 1) % SSD1306_ASYNC_SEGMENTS;
+      if (--segment_count == 0) {
+        pump_clock(false);
+        pump_bus = PUMP_IDLE;
+      } else { // bus free until the next tick
+        pump_begin();
+        pump_bus = PUMP_START;
+      }
+      break;
+  }
+}
+#endif
 
-void SSD1306::begin(void)
+template <uint8_t W, uint8_t P, uint8_t X>
+SSD1306_Panel<W, P, X>::SSD1306_Panel(void) : font_size(1) {}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::begin(void)
 {
+  i2c_begin();
+#if SSD1306_ASYNC_SEGMENTS > 0
+  USICR = PUMP_USICR;
+#endif
+
+  // send all configuration in one command stream
+  ssd1306_send_command_start();
+#ifdef SSD1306_POWER_PROFILES
+  send_power_profile(power_profile);
+#endif
   for (uint8_t i = 0; i < sizeof (ssd1306_configuration); i++) {
-    ssd1306_send_command(pgm_read_byte_near(&ssd1306_configuration[i]));
+    ssd1306_send_command_byte(pgm_read_byte_near(&ssd1306_configuration[i]));
+  }
+  ssd1306_send_command_stop();
+  window_valid = false;
+}
+
+#ifdef SSD1306_POWER_PROFILES
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::send_power_profile(uint8_t profile)
+{
+  ssd1306_power_profile_t p;
+  memcpy_P(&p, &ssd1306_power_profiles[profile], sizeof (p));
+  ssd1306_send_command_byte(0x81); // Set Contrast Control
+  ssd1306_send_command_byte(p.contrast);
+  ssd1306_send_command_byte(0xD9); // Set Pre-charge Period
+  ssd1306_send_command_byte(p.precharge);
+  ssd1306_send_command_byte(0xDB); // Set VCOMH Deselect Level
+  ssd1306_send_command_byte(p.vcomh);
+  ssd1306_send_command_byte(0xD5); // Set Display Clock Divide Ratio / Oscillator Frequency
+  ssd1306_send_command_byte(p.clock);
+  ssd1306_send_command_byte(0xA8); // Set MUX Ratio, 0F-3F
+  ssd1306_send_command_byte(((p.rows) ? p.rows : (P * 8)) - 1);
+  ssd1306_send_command_byte(0xD3); // Set Display Offset
+  ssd1306_send_command_byte(p.offset);
+  power_profile = profile;
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::set_power_profile(uint8_t profile)
+{
+  if (profile >= SSD1306_PROFILE_COUNT) return;
+  ssd1306_send_command_start();
+  send_power_profile(profile);
+  ssd1306_send_command_stop();
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+uint8_t SSD1306_Panel<W, P, X>::get_power_profile(void)
+{
+  return power_profile;
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+uint16_t SSD1306_Panel<W, P, X>::power_profile_ua(uint8_t profile)
+{
+  return pgm_read_word_near(&ssd1306_power_profiles[profile].current_ua);
+}
+#endif
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::flush(void) {
+  if (data_started) {
+    ssd1306_send_data_stop();
   }
 }
 
-void SSD1306::ssd1306_send_command_start(void) {
-  TinyWireM.beginTransmission(SSD1306_I2C_ADDR);
-  TinyWireM.send(0x00); //command
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_command_start(void) {
+  flush(); // commands cannot follow data in the same transaction
+#if SSD1306_ASYNC_SEGMENTS > 0
+  stage_start(0x00); //command
+#else
+  i2c_start(SSD1306_I2C_ADDR);
+  i2c_write(0x00); //command
+#endif
+  COUNT_SENT(2);
+  COUNT_TRANSACTION();
 }
 
-void SSD1306::ssd1306_send_command_stop(void) {
-  TinyWireM.endTransmission();
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_command_stop(void) {
+#if SSD1306_ASYNC_SEGMENTS > 0
+  stage_stop();
+#else
+  i2c_stop();
+#endif
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_command_byte(uint8_t command)
+{
+#ifdef SSD1306_TINYWIREM
+  if (i2c_write(command) == 0) {
+    // push commands if detect buffer used up
+    ssd1306_send_command_stop();
+    ssd1306_send_command_start();
+    i2c_write(command);
+  }
+#elif SSD1306_ASYNC_SEGMENTS > 0
+  stage_byte(command);
+#else
+  i2c_write(command);
+#endif
+  COUNT_SENT(1);
 }
 
-void SSD1306::ssd1306_send_command(uint8_t command)
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_command(uint8_t command)
 {
   ssd1306_send_command_start();
-  TinyWireM.send(command);
+  ssd1306_send_command_byte(command);
   ssd1306_send_command_stop();
 }
 
-void SSD1306::ssd1306_send_data_start(void)
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_data_start(void)
 {
-  TinyWireM.beginTransmission(SSD1306_I2C_ADDR);
-  TinyWireM.send(0x40); //data
+#if SSD1306_ASYNC_SEGMENTS > 0
+  stage_start(0x40); //data
+#else
+  i2c_start(SSD1306_I2C_ADDR);
+  i2c_write(0x40); //data
+#endif
+  COUNT_SENT(2);
+  COUNT_TRANSACTION();
+  data_started = true;
 }
 
-void SSD1306::ssd1306_send_data_stop(void)
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_data_stop(void)
 {
-  TinyWireM.endTransmission();
+#if SSD1306_ASYNC_SEGMENTS > 0
+  stage_stop();
+#else
+  i2c_stop();
+#endif
+  data_started = false;
 }
 
-void SSD1306::ssd1306_send_data_byte(uint8_t data)
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_data_byte(uint8_t data)
 {
-  if (TinyWireM.write(data) == 0) {
+#ifdef SSD1306_TINYWIREM
+  if (i2c_write(data) == 0) {
     // push data if detect buffer used up
     ssd1306_send_data_stop();
     ssd1306_send_data_start();
-    TinyWireM.write(data);
+    i2c_write(data);
   }
+#elif SSD1306_ASYNC_SEGMENTS > 0
+  stage_byte(data);
+#else
+  i2c_write(data);
+#endif
+  COUNT_SENT(1);
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_data_repeat(uint8_t data, uint8_t count)
+{
+#if SSD1306_ASYNC_SEGMENTS > 0
+  stage_ref(SEG_REPEAT, NULL, count, 0, 0);
+  stage.bytes[0] = data;
+  COUNT_SENT(count);
+#else
+  while (count--) ssd1306_send_data_byte(data);
+#endif
+}
+
+// glyph bytes from PROGMEM
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_data_pgm(const uint8_t *data, uint8_t len, uint8_t invert)
+{
+#if SSD1306_ASYNC_SEGMENTS > 0
+  stage_ref(SEG_PGM, data, len, invert, 0);
+  COUNT_SENT(len);
+#else
+  while (len--) ssd1306_send_data_byte(pgm_read_byte_near(data++) ^ invert);
+#endif
+}
+
+// bytes in RAM, sent before it returns
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_data_ram(const uint8_t *data, uint8_t len)
+{
+#if SSD1306_ASYNC_SEGMENTS > 0
+  stage_ref(SEG_RAM, data, len, 0, 0);
+  COUNT_SENT(len);
+  queue_stage();
+  wait_segments(0);
+#else
+  while (len--) ssd1306_send_data_byte(*data++);
+#endif
 }
 
-void SSD1306::set_area(uint8_t col, uint8_t page, uint8_t col_range_minus_1, uint8_t page_range_minus_1)
+// run length glyph, decoded as it is sent
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::ssd1306_send_data_rle(const uint8_t *bitmap, uint8_t glyph, uint8_t len, uint8_t invert)
 {
+#if SSD1306_ASYNC_SEGMENTS > 0
+  stage_ref(SEG_RLE, bitmap, len, invert, glyph);
+  COUNT_SENT(len);
+#else
+  rle_glyph_t rle;
+  rle_glyph_start(rle, bitmap, glyph);
+  while (len--) ssd1306_send_data_byte(rle_glyph_next(rle) ^ invert);
+#endif
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::set_area(uint8_t col, uint8_t page, uint8_t col_range_minus_1, uint8_t page_range_minus_1)
+{
+  // vertical addressing mode already set in configuration
   ssd1306_send_command_start();
-  TinyWireM.send(0x20);
-  TinyWireM.send(0x01);
-  TinyWireM.send(0x21);
-#ifdef XOFFSET // SCREEN_SCREEN_64X32
-  TinyWireM.send(XOFFSET + col);
-  TinyWireM.send(XOFFSET + col + col_range_minus_1);
-#else // SCREEN_128_64 / SCREEN_128X32
-  TinyWireM.send(col);
-  TinyWireM.send(col + col_range_minus_1);
-#endif
-  TinyWireM.send(0x22);
-  TinyWireM.send(page);
-  TinyWireM.send(page + page_range_minus_1);
+  ssd1306_send_command_byte(0x21);
+  ssd1306_send_command_byte(X + col); // X: GDDRAM column of a narrow panel's first pixel
+  ssd1306_send_command_byte(X + col + col_range_minus_1);
+  ssd1306_send_command_byte(0x22);
+  ssd1306_send_command_byte(page);
+  ssd1306_send_command_byte(page + page_range_minus_1);
   ssd1306_send_command_stop();
+
+  window_valid = true;
+  window_page = page;
+  window_height = page_range_minus_1 + 1;
+  window_col_end = col + col_range_minus_1;
+  window_next_col = col;
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::set_write_area(uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height)
+{
+  if ((!window_valid) || (set_col != window_next_col) || (set_page != window_page)
+      || (height != window_height) || (set_col + width - 1 > window_col_end)) {
+    // open window till the right edge, following glyphs in the same run need not re-address
+    set_area(set_col, set_page, W - 1 - set_col, height - 1);
+  }
+  if (!data_started) ssd1306_send_data_start();
+  window_next_col = set_col + width;
+}
+
+#if SSD1306_CELL_CACHE_SIZE > 0
+typedef struct {
+  uint8_t col;
+  uint8_t page;
+  uint8_t width;
+  uint8_t attr; // bit 0-3: height in pages (0 = unused cell), bit 5: shapes, bit 6: pattern, bit 7: invert color
+  uint8_t code; // ascii code, pattern or key of the shapes
+} ssd1306_cell_t;
+
+static ssd1306_cell_t cells[SSD1306_CELL_CACHE_SIZE];
+static uint8_t next_cell = 0;
+
+#define CELL_HEIGHT_MASK 0x0F
+#define CELL_SHAPES 0x20
+#define CELL_PATTERN 0x40
+#define CELL_INVERT 0x80
+
+static void clear_cells(void) {
+  for (uint8_t i = 0; i < SSD1306_CELL_CACHE_SIZE; i++) {
+    cells[i].attr = 0;
+  }
+}
+
+// return true if the same glyph or pattern already drawn at the same area,
+// otherwise record it as the area's new content
+// forget the cells an area overwrites
+static void forget_cells(uint8_t col, uint8_t page, uint8_t width, uint8_t height) {
+  for (uint8_t i = 0; i < SSD1306_CELL_CACHE_SIZE; i++) {
+    ssd1306_cell_t *cell = &cells[i];
+    if (cell->attr != 0) {
+      if ((cell->col < col + width) && (col < cell->col + cell->width)
+          && (cell->page < page + height) && (page < cell->page + (cell->attr & CELL_HEIGHT_MASK))) {
+        cell->attr = 0;
+      }
+    }
+  }
+}
+
+static bool cell_cached(uint8_t col, uint8_t page, uint8_t width, uint8_t attr, uint8_t code) {
+  uint8_t free_cell = SSD1306_CELL_CACHE_SIZE;
+  ssd1306_cell_t *cell;
+
+  // recorded cells never overlap, so an area match is the only cell covering it
+  for (uint8_t i = 0; i < SSD1306_CELL_CACHE_SIZE; i++) {
+    cell = &cells[i];
+    if ((cell->col == col) && (cell->page == page) && (cell->width == width) && (cell->attr == attr)) {
+      if (cell->code == code) return true;
+      cell->code = code;
+      return false;
+    }
+  }
+
+  // new area: forget the cells it overwrites
+  forget_cells(col, page, width, attr & CELL_HEIGHT_MASK);
+  for (uint8_t i = 0; i < SSD1306_CELL_CACHE_SIZE; i++) {
+    if ((cells[i].attr == 0) && (free_cell == SSD1306_CELL_CACHE_SIZE)) free_cell = i;
+  }
+
+  if (free_cell == SSD1306_CELL_CACHE_SIZE) { // cache full, replace in round robin
+    free_cell = next_cell;
+    if (++next_cell >= SSD1306_CELL_CACHE_SIZE) next_cell = 0;
+  }
+  cell = &cells[free_cell];
+  cell->col = col;
+  cell->page = page;
+  cell->width = width;
+  cell->attr = attr;
+  cell->code = code;
+  return false;
 }
+#endif
 
-void SSD1306::fill(uint8_t data)
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::fill(uint8_t data)
 {
-  set_area(0, 0, WIDTH - 1, PAGES - 1);
-  uint16_t data_size = (WIDTH) * (PAGES);
+#if SSD1306_CELL_CACHE_SIZE > 0
+  clear_cells();
+#endif
+  set_area(0, 0, W - 1, P - 1);
 
   ssd1306_send_data_start();
-  for (uint16_t i = 0; i < data_size; i++)
+  for (uint8_t i = 0; i < P; i++)
   {
-    ssd1306_send_data_byte(data);
+    ssd1306_send_data_repeat(data, W);
   }
   ssd1306_send_data_stop();
+  window_valid = false;
 }
 
-void SSD1306::v_line(uint8_t col, uint8_t data)
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::v_line(uint8_t col, uint8_t data)
 {
-  set_area(col, 0, 0, PAGES);
+  set_area(col, 0, 0, P);
   ssd1306_send_data_start();
-  for (uint8_t i = 0; i <= PAGES; i++)
-  {
-    ssd1306_send_data_byte(data);
-  }
+  ssd1306_send_data_repeat(data, P + 1);
   ssd1306_send_data_stop();
+  window_valid = false;
 }
 
 static uint8_t col = 0;
 static uint8_t page = 0;
 static bool invert_color = false;
-static uint8_t font_size = 1;
-static uint8_t font_width = FONT_WIDTH;
-static uint8_t font_volume = 1 * FONT_WIDTH;
-static uint8_t ascii_code_start = FONT_RANGE_START;
-static uint8_t ascii_code_end = FONT_RANGE_END;
+#define NO_GLYPH 0xFF // glyph map entry of a character left out of the font
+
+/*
+ * Font set, one ssd1306_font<size> per font header included by ssd1306.h.
+ * map() is NULL for a contiguous font, rle is true for run length glyphs.
+ */
+template <uint8_t SIZE> struct ssd1306_font;
+
+template <> struct ssd1306_font<1> {
+  static const uint8_t width = FONT_WIDTH;
+  static const uint8_t range_start = FONT_RANGE_START;
+  static const uint8_t range_end = FONT_RANGE_END;
+  static const uint8_t *bitmap() { return font_bitmap; }
+#ifdef FONT_MAP
+  static const uint8_t *map() { return font_map; }
+#else
+  static const uint8_t *map() { return NULL; }
+#endif
+#ifdef FONT_RLE
+  static const bool rle = true;
+#else
+  static const bool rle = false;
+#endif
+};
+
+#ifdef FONT_2X_WIDTH
+template <> struct ssd1306_font<2> {
+  static const uint8_t width = FONT_2X_WIDTH;
+  static const uint8_t range_start = FONT_2X_RANGE_START;
+  static const uint8_t range_end = FONT_2X_RANGE_END;
+  static const uint8_t *bitmap() { return font_2x_bitmap; }
+#ifdef FONT_2X_MAP
+  static const uint8_t *map() { return font_2x_map; }
+#else
+  static const uint8_t *map() { return NULL; }
+#endif
+#ifdef FONT_2X_RLE
+  static const bool rle = true;
+#else
+  static const bool rle = false;
+#endif
+};
+#endif
+
+#ifdef FONT_3X_WIDTH
+template <> struct ssd1306_font<3> {
+  static const uint8_t width = FONT_3X_WIDTH;
+  static const uint8_t range_start = FONT_3X_RANGE_START;
+  static const uint8_t range_end = FONT_3X_RANGE_END;
+  static const uint8_t *bitmap() { return font_3x_bitmap; }
+#ifdef FONT_3X_MAP
+  static const uint8_t *map() { return font_3x_map; }
+#else
+  static const uint8_t *map() { return NULL; }
+#endif
+#ifdef FONT_3X_RLE
+  static const bool rle = true;
+#else
+  static const bool rle = false;
+#endif
+};
+#endif
 
-void SSD1306::set_pos(uint8_t set_col, uint8_t set_page) {
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::set_pos(uint8_t set_col, uint8_t set_page) {
   col = set_col;
   page = set_page;
 }
 
-void SSD1306::draw_pattern(uint8_t width, uint8_t pattern) {
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::draw_pattern(uint8_t width, uint8_t pattern) {
   draw_pattern(col, page, width, 1, pattern);
 }
 
-void SSD1306::draw_pattern(uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height, uint8_t pattern) {
-  set_area(set_col, set_page, width, height - 1);
-  ssd1306_send_data_start();
-  for (uint8_t i = 0; i < (width * height); i++) {
-    ssd1306_send_data_byte(pattern);
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::draw_pattern(uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height, uint8_t pattern) {
+#if SSD1306_CELL_CACHE_SIZE > 0
+  if (cell_cached(set_col, set_page, width, CELL_PATTERN | height, pattern)) {
+    COUNT_SKIPPED((width * height) + CELL_OVERHEAD_BYTES);
+    col = set_col + width;
+    page = set_page;
+    return;
   }
-  ssd1306_send_data_stop();
+#endif
+
+  set_write_area(set_col, set_page, width, height);
+  ssd1306_send_data_repeat(pattern, width * height);
 
   col = set_col + width;
   page = set_page;
 }
 
-void SSD1306::set_invert_color(bool set_invert) {
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::set_invert_color(bool set_invert) {
   invert_color = set_invert;
 }
 
-void SSD1306::set_font_size(uint8_t set_size) {
-  font_size = set_size;
-  if (set_size == 1) {
-    font_width = FONT_WIDTH;
-    font_volume = 1 * FONT_WIDTH;
-    ascii_code_start = FONT_RANGE_START;
-    ascii_code_end = FONT_RANGE_END;
+// glyph loop of one font, size is its height in pages
+template <uint8_t W, uint8_t P, uint8_t X>
+template <uint8_t SIZE>
+inline size_t SSD1306_Panel<W, P, X>::write_glyph(uint8_t c) {
+  typedef ssd1306_font<SIZE> font;
+  const uint8_t volume = SIZE * font::width;
+
+  if ((c < font::range_start) || (c > font::range_end)) return 0;
+  uint8_t glyph = c - font::range_start;
+  if (font::map()) {
+    glyph = pgm_read_byte_near(&font::map()[glyph]);
+    if (glyph == NO_GLYPH) return 0; // not in the subset font
+  }
+
+#if SSD1306_CELL_CACHE_SIZE > 0
+  if (cell_cached(col, page, font::width, (invert_color ? CELL_INVERT : 0) | SIZE, c)) {
+    COUNT_SKIPPED(volume + CELL_OVERHEAD_BYTES);
+    col += font::width;
+    return font::width;
+  }
+#endif
+
+  set_write_area(col, page, font::width, SIZE);
+
+  uint8_t invert = invert_color ? 0xFF : 0x00;
+  if (font::rle) { // decoded straight into the data stream
+    ssd1306_send_data_rle(font::bitmap(), glyph, volume, invert);
+  } else {
+    ssd1306_send_data_pgm(&font::bitmap()[glyph * volume], volume, invert);
+  }
+
+  // move pos forward
+  col += font::width;
+  return font::width;
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+size_t SSD1306_Panel<W, P, X>::write(uint8_t c) {
+  switch (font_size) {
 #ifdef FONT_2X_WIDTH
-  } else if (set_size == 2) {
-    font_width = FONT_2X_WIDTH;
-    font_volume = 2 * FONT_2X_WIDTH;
-    ascii_code_start = FONT_2X_RANGE_START;
-    ascii_code_end = FONT_2X_RANGE_END;
+    case 2:
+      return write_glyph<2>(c);
 #endif
 #ifdef FONT_3X_WIDTH
-  } else if (set_size == 3) {
-    font_width = FONT_3X_WIDTH;
-    font_volume = 3 * FONT_3X_WIDTH;
-    ascii_code_start = FONT_3X_RANGE_START;
-    ascii_code_end = FONT_3X_RANGE_END;
+    case 3:
+      return write_glyph<3>(c);
 #endif
+    default:
+      return write_glyph<1>(c);
   }
 }
 
-size_t SSD1306::write(uint8_t c) {
-  if ((c < ascii_code_start) || (c > ascii_code_end)) return 0;
+#ifdef SSD1306_SHAPES
+/*
+ * Page band renderer: the shapes are rasterized one page at a time into a
+ * buffer of the area width on the stack, each page is sent in one data
+ * transaction. Shapes are clipped to the area.
+ */
+// bits of rows y0 - y1 in a page
+static uint8_t band_rows(uint8_t page, int16_t y0, int16_t y1) {
+  int16_t top = page * 8;
+  if ((y1 < top) || (y0 > top + 7) || (y1 < y0)) return 0;
+  uint8_t first = (y0 > top) ? (y0 - top) : 0;
+  uint8_t last = (y1 < top + 7) ? (y1 - top) : 7;
+  return (uint8_t)(0xFF << first) & (uint8_t)(0xFF >> (7 - last));
+}
 
-  set_area(col, page, font_width - 1, font_size - 1);
+static void band_set(uint8_t *band, uint8_t width, int16_t x, uint8_t bits, bool clear) {
+  if ((x < 0) || (x >= width)) return;
+  if (clear) {
+    band[x] &= ~bits;
+  } else {
+    band[x] |= bits;
+  }
+}
 
-  uint16_t offset = (c - ascii_code_start) * font_volume;
-  uint8_t data;
+// column major bitmap, pages of 8 rows per column as the fonts, at x, y of the band
+static void band_bitmap(uint8_t *band, uint8_t width, uint8_t page, int16_t x, uint8_t y,
+                        uint8_t w, uint8_t h, const uint8_t *bitmap, bool clear) {
+  uint8_t pages = (h + 7) >> 3;
+  uint8_t mask = band_rows(page, y, y + h - 1);
+  if (!mask) return;
+  int8_t bitmap_page = page - (y >> 3); // the one at the top of this page, the one before shifted in
+  uint8_t shift = y & 7;
+  for (uint8_t i = 0; i < w; i++, x++) {
+    if ((x < 0) || (x >= width)) continue;
+    const uint8_t *column = &bitmap[i * pages];
+    uint8_t bits = 0;
+    if ((bitmap_page >= 0) && (bitmap_page < pages)) bits = pgm_read_byte_near(&column[bitmap_page]) << shift;
+    if (shift && (bitmap_page >= 1) && (bitmap_page <= pages)) bits |= pgm_read_byte_near(&column[bitmap_page - 1]) >> (8 - shift);
+    band_set(band, width, x, bits & mask, clear);
+  }
+}
 
-  ssd1306_send_data_start();
-  for (uint8_t i = 0; i < font_volume; i++)
-  {
-    if (font_size == 1) {
-      data = pgm_read_byte_near(&font_bitmap[offset++]);      
-#ifdef FONT_2X_WIDTH
-    } else if (font_size == 2) {
-      data = pgm_read_byte_near(&font_2x_bitmap[offset++]);
-#endif
-#ifdef FONT_3X_WIDTH
-    } else if (font_size == 3) {
-      data = pgm_read_byte_near(&font_3x_bitmap[offset++]);
-#endif
+static void band_shape(uint8_t *band, uint8_t band_col, uint8_t width, uint8_t page, const ssd1306_shape_t &shape) {
+  bool clear = shape.type & SHAPE_CLEAR;
+  int16_t x = shape.x - band_col;
+  switch (shape.type & ~SHAPE_CLEAR) {
+    case SHAPE_LINE: { // Bresenham, only the points in this page
+      int16_t y = shape.y;
+      int16_t x1 = shape.w - band_col;
+      int16_t y1 = shape.h;
+      int16_t dx = (x1 > x) ? (x1 - x) : (x - x1);
+      int16_t dy = (y1 > y) ? (y - y1) : (y1 - y);
+      int8_t sx = (x < x1) ? 1 : -1;
+      int8_t sy = (y < y1) ? 1 : -1;
+      int16_t err = dx + dy;
+      for (;;) {
+        if ((y >> 3) == page) band_set(band, width, x, 1 << (y & 7), clear);
+        if ((x == x1) && (y == y1)) break;
+        int16_t e2 = err * 2;
+        if (e2 >= dy) {
+          err += dy;
+          x += sx;
+        }
+        if (e2 <= dx) {
+          err += dx;
+          y += sy;
+        }
+      }
+      break;
+    }
+    case SHAPE_RECT: {
+      uint8_t bottom = shape.y + shape.h - 1;
+      uint8_t edge = band_rows(page, shape.y, bottom);
+      uint8_t inner = band_rows(page, shape.y, shape.y) | band_rows(page, bottom, bottom);
+      for (uint8_t i = 0; i < shape.w; i++) {
+        band_set(band, width, x + i, ((i == 0) || (i == shape.w - 1)) ? edge : inner, clear);
+      }
+      break;
+    }
+    case SHAPE_FILL: {
+      uint8_t bits = band_rows(page, shape.y, shape.y + shape.h - 1);
+      for (uint8_t i = 0; i < shape.w; i++) band_set(band, width, x + i, bits, clear);
+      break;
+    }
+    case SHAPE_BITMAP:
+      band_bitmap(band, width, page, x, shape.y, shape.w, shape.h, shape.bitmap, clear);
+      break;
+    case SHAPE_GLYPH: { // small font, a run length one is not drawn
+      typedef ssd1306_font<1> font;
+      uint8_t c = shape.w;
+      if (font::rle || (c < font::range_start) || (c > font::range_end)) break;
+      uint8_t glyph = c - font::range_start;
+      if (font::map()) {
+        glyph = pgm_read_byte_near(&font::map()[glyph]);
+        if (glyph == NO_GLYPH) break;
+      }
+      band_bitmap(band, width, page, x, shape.y, font::width, 8, &font::bitmap()[glyph * font::width], clear);
+      break;
     }
-    if (invert_color) data = ~ data; // invert
-    ssd1306_send_data_byte(data);
   }
-  ssd1306_send_data_stop();
+}
 
-  // move pos forward
-  col += font_width;
-  return font_width;
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::draw_shapes(const ssd1306_shape_t *shapes, uint8_t count,
+                                         uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height,
+#if SSD1306_CELL_CACHE_SIZE > 0
+                                         uint8_t key) {
+  if (cell_cached(set_col, set_page, width, CELL_SHAPES | height, key)) {
+    COUNT_SKIPPED((width * height) + (height * CELL_OVERHEAD_BYTES));
+    return;
+  }
+#else
+                                         uint8_t) { // no cell cache to key
+#endif
+
+  uint8_t band[W];
+  for (uint8_t p = set_page; p < set_page + height; p++) {
+    memset(band, 0, width);
+    for (uint8_t i = 0; i < count; i++) band_shape(band, set_col, width, p, shapes[i]);
+    set_area(set_col, p, width - 1, 0);
+    ssd1306_send_data_start();
+    ssd1306_send_data_ram(band, width);
+    ssd1306_send_data_stop();
+  }
+  window_valid = false;
+}
+#endif
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::set_column_area(uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height) {
+#if SSD1306_CELL_CACHE_SIZE > 0
+  forget_cells(set_col, set_page, width, height);
+#endif
+  set_area(set_col, set_page, width - 1, height - 1);
+  ssd1306_send_data_start();
+  window_valid = false; // the glyph run after this one addresses again
 }
 
-void SSD1306::print_string(uint8_t col, uint8_t page, const char str[]) {
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::print_string(uint8_t col, uint8_t page, const char str[]) {
     set_pos(col, page);
     print(str);
 }
 
-void SSD1306::off(void)
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::off(void)
 {
   ssd1306_send_command(0xAE);
 }
 
-void SSD1306::on(void)
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::on(void)
 {
   ssd1306_send_command(0xAF);
 }
 
+template <uint8_t W, uint8_t P, uint8_t X>
+bool SSD1306_Panel<W, P, X>::busy(void)
+{
+#if SSD1306_ASYNC_SEGMENTS > 0
+  return stage_open || (segment_count != 0);
+#else
+  return false;
+#endif
+}
+
+#ifdef SSD1306_STATS
+template <uint8_t W, uint8_t P, uint8_t X>
+uint32_t SSD1306_Panel<W, P, X>::get_sent_bytes() {
+  return sent_bytes;
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+uint32_t SSD1306_Panel<W, P, X>::get_skipped_bytes() {
+  return skipped_bytes;
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+void SSD1306_Panel<W, P, X>::skip_area(uint8_t width, uint8_t height) {
+  COUNT_SKIPPED((width * height) + CELL_OVERHEAD_BYTES);
+}
+
+template <uint8_t W, uint8_t P, uint8_t X>
+uint32_t SSD1306_Panel<W, P, X>::get_sent_transactions() {
+  return sent_transactions;
+}
+#endif
+
+// the panel selected in ssd1306.h
+template class SSD1306_Panel<WIDTH, PAGES, XOFFSET>;
@@ -3,7 +3,14 @@
  * DigisparkOLED: https://github.com/digistump/DigistumpArduino/tree/master/digistump-avr/libraries/DigisparkOLED
  * SSD1306 data sheet: https://www.adafruit.com/datasheets/SSD1306.pdf
  */
-#include <TinyWireM.h>
+#ifndef _ssd1306_h
+#define _ssd1306_h
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
 #include "font.h"
 #include "font_2x.h"
 //#include "font_3x.h"
@@ -13,6 +20,44 @@
   #define SSD1306_I2C_ADDR 0x3C
 #endif
 
+// I2C transport: the zero copy USI master in USI_I2C.cpp (default), or TinyWireM by define SSD1306_TINYWIREM
+//#define SSD1306_TINYWIREM
+
+// asynchronous transfers by define SSD1306_ASYNC_SEGMENTS, the ring size, 0 (default) to send while drawing
+// a segment is a run of command or data bytes, by reference to the glyph (6 bytes RAM per segment);
+// ISR(TIMER0_COMPB_vect) strobes an SCL edge every SSD1306_ASYNC_EDGE_TICKS Timer0 ticks and
+// ISR(USI_OVF_vect) feeds the USI a byte at a time, the CPU idles in between. Timer0 keeps
+// running for millis(), only its compare B is taken. Wait for busy() false before power down.
+// The pump clocks SCL at ~42 kHz at 8 MHz (a 47 byte frame in ~10 ms against ~1 ms sent while
+// drawing) and its interrupts cost more CPU than the blocking transfer, worse at 1 MHz: only worth
+// it when the CPU has other work while a frame goes out.
+#ifndef SSD1306_ASYNC_SEGMENTS
+  #define SSD1306_ASYNC_SEGMENTS 0
+#endif
+#ifndef SSD1306_ASYNC_EDGE_TICKS
+  #define SSD1306_ASYNC_EDGE_TICKS 2 // 8 - 16 us at CK/64 and 8 MHz, 1 could miss a tick counted while it is set
+#endif
+#ifdef SSD1306_TINYWIREM
+  #undef SSD1306_ASYNC_SEGMENTS
+  #define SSD1306_ASYNC_SEGMENTS 0 // the pump drives the USI itself
+#endif
+
+// text cell cache by define SSD1306_CELL_CACHE_SIZE, the number of cells, 0 (default) for none
+// each cell remember the last glyph or pattern drawn at a screen area (5 bytes RAM per cell),
+// a round robin cache smaller than the glyphs of a frame never hits: 32 for the time page,
+// 16 for the debug page. The watch keeps the time page fields itself, see draw_oled().
+#ifndef SSD1306_CELL_CACHE_SIZE
+  #define SSD1306_CELL_CACHE_SIZE 0
+#endif
+
+// display lists by define SSD1306_SHAPES, draw_shapes() and its page band renderer: lines, outlines,
+// fills, bitmaps and glyphs at any pixel, a data transaction per page; the watch draws with patterns
+//#define SSD1306_SHAPES
+
+// bus statistics by define SSD1306_STATS, the bytes and transactions sent and the bytes skipped,
+// for the host benches and the power page; a 32-bit count at every byte sent is ~1 KB of flash
+//#define SSD1306_STATS
+
 // custom screen resolution by define SCREEN128X64, SCREEN128X32, SCREEN64X48 or SCREED64X32 (default)
 //#define SCREEN_128X64
 //#define SCREEN_128X32
@@ -20,11 +65,11 @@
 #define SCREEN_64X32
 
 #ifdef SCREEN_128X64
-  #define WIDTH 0x0100
+  #define WIDTH 0x80
   #define PAGES 0x08
 #else
 #ifdef SCREEN_128X32
-  #define WIDTH 0x0100
+  #define WIDTH 0x80
   #define PAGES 0x04
 #else
 #ifdef SCREEN_64X48
@@ -38,32 +83,110 @@
 #endif
 #endif
 #endif
+#ifndef XOFFSET
+  #define XOFFSET 0x00
+#endif
 
-class SSD1306 : public Print {
+// panel power profiles by define SSD1306_POWER_PROFILES, set_power_profile() takes one of these,
+// without it begin() sets the normal one. The currents of power_profile_ua() are estimates, not
+// measured, and GLANCE is not verified on a panel
+//#define SSD1306_POWER_PROFILES
+#define SSD1306_PROFILE_BRIGHT 0
+#define SSD1306_PROFILE_NORMAL 1 // after begin()
+#define SSD1306_PROFILE_DIM 2 // low battery
+#define SSD1306_PROFILE_GLANCE 3 // 16 rows, GDDRAM rows 16 - 31 on the first rows
+#define SSD1306_PROFILE_COUNT 4
+
+#ifdef SSD1306_SHAPES
+/*
+ * Display list of draw_shapes(), coordinates in screen pixels
+ */
+#define SHAPE_LINE 0 // from x, y to w, h
+#define SHAPE_RECT 1 // outline, w x h
+#define SHAPE_FILL 2 // w x h
+#define SHAPE_BITMAP 3 // PROGMEM bitmap, w x h, column major, 8 rows per byte as the fonts
+#define SHAPE_GLYPH 4 // character w of the small font, at x, y
+#define SHAPE_CLEAR 0x80 // or'ed to the type: dark pixels
+
+typedef struct {
+  uint8_t type;
+  uint8_t x, y;
+  uint8_t w, h;
+  const uint8_t *bitmap;
+} ssd1306_shape_t;
+#endif
+
+/*
+ * The driver is a template on the panel geometry, so column and page limits are
+ * constants, and write() switches on the font size into a glyph loop
+ * write_glyph<size>() compiled inline once per font.
+ * SSD1306 below is the panel selected above.
+ */
+template <uint8_t W, uint8_t P, uint8_t X>
+class SSD1306_Panel : public Print {
 
   public:
-    virtual size_t write(uint8_t);
+    virtual size_t write(uint8_t c);
 
-    SSD1306(void);
+    SSD1306_Panel(void);
     void begin(void);
     void ssd1306_send_command_start(void);
     void ssd1306_send_command_stop(void);
+    void ssd1306_send_command_byte(uint8_t command);
     void ssd1306_send_command(uint8_t command);
     void ssd1306_send_data_start(void);
     void ssd1306_send_data_stop(void);
     void ssd1306_send_data_byte(uint8_t byte);
+    void ssd1306_send_data_repeat(uint8_t byte, uint8_t count);
+    void ssd1306_send_data_pgm(const uint8_t *data, uint8_t len, uint8_t invert);
+    void ssd1306_send_data_ram(const uint8_t *data, uint8_t len);
+    void ssd1306_send_data_rle(const uint8_t *bitmap, uint8_t glyph, uint8_t len, uint8_t invert);
     void set_area(uint8_t col, uint8_t page, uint8_t col_range_minus_1, uint8_t page_range_minus_1);
+    void set_write_area(uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height);
+    void flush(void); // send out glyph data still buffered, call after drawing a frame
     void v_line(uint8_t col, uint8_t fill);
     void fill(uint8_t fill);
     void set_pos(uint8_t set_col, uint8_t set_page);
     void set_invert_color(bool set_invert);
-    void set_font_size(uint8_t set_font_size);
+    void set_font_size(uint8_t set_font_size) { font_size = set_font_size; } // a size not included draws the small font
 
     void draw_pattern(uint8_t width, uint8_t pattern);
     void draw_pattern(uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height, uint8_t pattern);
     void print_string(uint8_t set_col, uint8_t set_page, const char str[]);
+#ifdef SSD1306_SHAPES
+    // rasterize shapes a page at a time into the area, width up to the screen width,
+    // key tells the content apart for the cell cache: same key, same area, not sent again; unused without the cache
+    void draw_shapes(const ssd1306_shape_t *shapes, uint8_t count,
+                     uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height, uint8_t key);
+#endif
+    // area of whole columns for raw data: send height bytes per column, top page first,
+    // with ssd1306_send_data_byte() and end with flush(), the cells under it are forgotten
+    void set_column_area(uint8_t set_col, uint8_t set_page, uint8_t width, uint8_t height);
 
     void off();
     void on();
+    bool busy(); // asynchronous transfer not finished
+#ifdef SSD1306_POWER_PROFILES
+    void set_power_profile(uint8_t profile); // contrast, pre-charge, VCOMH, clock and MUX in one transaction
+    uint8_t get_power_profile();
+    static uint16_t power_profile_ua(uint8_t profile); // estimate, not measured
+#endif
+
+#ifdef SSD1306_STATS
+    uint32_t get_sent_bytes(); // debug use only
+    uint32_t get_skipped_bytes(); // debug use only
+    void skip_area(uint8_t width, uint8_t height); // an area the caller kept as drawn, counted as skipped
+    uint32_t get_sent_transactions(); // debug use only
+#endif
+
+  private:
+#ifdef SSD1306_POWER_PROFILES
+    void send_power_profile(uint8_t profile);
+#endif
+    template <uint8_t SIZE> size_t write_glyph(uint8_t c);
+    uint8_t font_size;
 };
 
+typedef SSD1306_Panel<WIDTH, PAGES, XOFFSET> SSD1306;
+
+#endif